@@ -0,0 +1,187 @@
+// Speed and quality of the block compression encoders. Encodes an image with every format on one thread
+// and on a pool, decodes the blocks again and reports the PSNR of the channels the format keeps.
+// Usage: block_compress_bench [image.png], without an image a generated test pattern is used.
+#include <utilities/blockCompress.hpp>
+#include <utilities/simd.hpp>
+#include <utilities/threadPool.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+const unsigned int PATTERN_SIZE = 1024;
+const int ITERATIONS = 3;
+
+const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Smooth gradients, noise and hard edges, roughly what photographed material textures contain
+PNGImage testPattern() {
+	PNGImage image;
+	image.width = PATTERN_SIZE;
+	image.height = PATTERN_SIZE;
+	image.pixels.resize(PATTERN_SIZE * PATTERN_SIZE * 4);
+	for (unsigned int y = 0; y < PATTERN_SIZE; y++) {
+		for (unsigned int x = 0; x < PATTERN_SIZE; x++) {
+			unsigned char* texel = &image.pixels[(y * PATTERN_SIZE + x) * 4];
+			const bool brick = ((y / 32) % 2 == 0 ? x : x + 32) % 64 < 60 && y % 32 < 28;
+			const int noise = rand() % 24;
+			texel[0] = (unsigned char)std::min(255, (brick ? 150 : 90) + int(60 * std::sin(x * 0.01f)) + noise);
+			texel[1] = (unsigned char)std::min(255, (brick ? 70 : 90) + int(y * 60 / PATTERN_SIZE) + noise);
+			texel[2] = (unsigned char)std::min(255, (brick ? 50 : 85) + noise);
+			texel[3] = 255;
+		}
+	}
+	return image;
+}
+
+// Reference decoders for what the encoders write
+void decodeBC1(const uint8_t* block, uint8_t texels[64]) {
+	const unsigned int color0 = block[0] | (block[1] << 8);
+	const unsigned int color1 = block[2] | (block[3] << 8);
+	int palette[4][3];
+	const unsigned int packed[2] = { color0, color1 };
+	for (int i = 0; i < 2; i++) {
+		const unsigned int r = packed[i] >> 11, g = (packed[i] >> 5) & 63, b = packed[i] & 31;
+		palette[i][0] = (r << 3) | (r >> 2);
+		palette[i][1] = (g << 2) | (g >> 4);
+		palette[i][2] = (b << 3) | (b >> 2);
+	}
+	for (int c = 0; c < 3; c++) {
+		if (color0 > color1) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (uint32_t(block[7]) << 24);
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) texels[i * 4 + c] = uint8_t(palette[(indices >> (i * 2)) & 3][c]);
+		texels[i * 4 + 3] = 255;
+	}
+}
+
+void decodeBC4(const uint8_t* block, unsigned int channel, uint8_t texels[64]) {
+	int palette[8] = { block[0], block[1] };
+	for (int i = 2; i < 8; i++) {
+		palette[i] = block[0] > block[1] ? ((8 - i) * block[0] + (i - 1) * block[1]) / 7
+			: i < 6 ? ((6 - i) * block[0] + (i - 1) * block[1]) / 5 : i == 6 ? 0 : 255;
+	}
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; i++) indices |= uint64_t(block[2 + i]) << (i * 8);
+	for (int i = 0; i < 16; i++) texels[i * 4 + channel] = uint8_t(palette[(indices >> (i * 3)) & 7]);
+}
+
+// Mode 6 only, the encoder writes nothing else
+void decodeBC7(const uint8_t* block, uint8_t texels[64]) {
+	unsigned int position = 7;
+	auto read = [&](unsigned int count) {
+		uint32_t value = 0;
+		for (unsigned int bit = 0; bit < count; bit++, position++) {
+			value |= uint32_t((block[position / 8] >> (position % 8)) & 1) << bit;
+		}
+		return value;
+	};
+	int endpoints[2][4];
+	for (int c = 0; c < 4; c++) {
+		endpoints[0][c] = read(7);
+		endpoints[1][c] = read(7);
+	}
+	const uint32_t p0 = read(1), p1 = read(1);
+	for (int c = 0; c < 4; c++) {
+		endpoints[0][c] = endpoints[0][c] * 2 + p0;
+		endpoints[1][c] = endpoints[1][c] * 2 + p1;
+	}
+	for (int i = 0; i < 16; i++) {
+		const int w = BC7_WEIGHTS[read(i == 0 ? 3 : 4)];
+		for (int c = 0; c < 4; c++) texels[i * 4 + c] = uint8_t(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+	}
+}
+
+// PSNR over the channels in [firstChannel, firstChannel + channelCount)
+double psnr(const PNGImage& image, TextureFileFormat format, const std::vector<uint8_t>& blocks, unsigned int firstChannel, unsigned int channelCount) {
+	const unsigned int blocksWide = (image.width + 3) / 4;
+	const uint32_t blockSize = textureFileElementSize(format);
+	double squaredError = 0;
+	size_t count = 0;
+	uint8_t texels[64] = {};
+	for (size_t block = 0; block * blockSize < blocks.size(); block++) {
+		const uint8_t* data = &blocks[block * blockSize];
+		switch (format) {
+		case TEXTURE_FILE_BC1: decodeBC1(data, texels); break;
+		case TEXTURE_FILE_BC4: decodeBC4(data, 0, texels); break;
+		case TEXTURE_FILE_BC5: decodeBC4(data, 0, texels); decodeBC4(data + 8, 1, texels); break;
+		case TEXTURE_FILE_BC7: decodeBC7(data, texels); break;
+		default: break;
+		}
+		for (unsigned int i = 0; i < 16; i++) {
+			const unsigned int x = unsigned(block % blocksWide) * 4 + i % 4;
+			const unsigned int y = unsigned(block / blocksWide) * 4 + i / 4;
+			if (x >= image.width || y >= image.height) continue;
+			for (unsigned int c = firstChannel; c < firstChannel + channelCount; c++) {
+				const double difference = double(texels[i * 4 + c]) - image.pixels[(y * image.width + x) * 4 + c];
+				squaredError += difference * difference;
+				count++;
+			}
+		}
+	}
+	const double meanSquaredError = squaredError / double(count);
+	return meanSquaredError == 0 ? INFINITY : 10 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+template <class F> double timeMilliseconds(F function) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++) {
+		function();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / ITERATIONS;
+}
+
+int main(int argc, char** argv) {
+	PNGImage image;
+	if (argc > 1) {
+		std::vector<unsigned char> png;
+		unsigned int error = lodepng::load_file(png, argv[1]);
+		if (!error) error = lodepng::decode(image.pixels, image.width, image.height, png);
+		if (error) {
+			fprintf(stderr, "Could not decode %s: %s\n", argv[1], lodepng_error_text(error));
+			return EXIT_FAILURE;
+		}
+	}
+	else {
+		image = testPattern();
+	}
+
+	ThreadPool single(1);
+	ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+	const double megapixels = image.width * image.height / 1e6;
+	printf("%ux%u image, %s, %u threads\n", image.width, image.height, SIMD_NAME, pool.size());
+	printf("%-6s %8s %14s %14s %10s\n", "", "bits/px", "1 thread", "pool", "PSNR");
+
+	struct Run {
+		TextureFileFormat format;
+		unsigned int firstChannel;
+		unsigned int channelCount;
+	};
+	const Run runs[] = {
+		{ TEXTURE_FILE_BC1, 0, 3 },
+		{ TEXTURE_FILE_BC4, 0, 1 },
+		{ TEXTURE_FILE_BC5, 0, 2 },
+		{ TEXTURE_FILE_BC7, 0, 4 },
+	};
+	std::vector<uint8_t> blocks;
+	for (const Run& run : runs) {
+		const double singleTime = timeMilliseconds([&]() { compressImage(image, run.format, single, blocks); });
+		const double poolTime = timeMilliseconds([&]() { compressImage(image, run.format, pool, blocks); });
+		printf("%-6s %8u %9.1fMpx/s %9.1fMpx/s %8.2fdB\n", textureFileFormatName(run.format), textureFileElementSize(run.format) * 8 / 16,
+			megapixels / (singleTime / 1000), megapixels / (poolTime / 1000), psnr(image, run.format, blocks, run.firstChannel, run.channelCount));
+	}
+	return 0;
+}
@@ -0,0 +1,132 @@
+// Creation and update throughput of the bind to edit, mutable storage path against the
+// direct state access, immutable storage path in glutils. Runs in a hidden GL 4.5 window.
+// Every timing ends with glFinish so the work the driver defers is counted as well.
+#include <utilities/glutils.h>
+#include <utilities/shapes.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Roughly the number of buffers and textures a large level load creates
+const int MESH_COUNT = 2000;
+const int TEXTURE_COUNT = 200;
+const int TEXTURE_SIZE = 256;
+// Dynamic buffers rewritten per frame, like the text meshes
+const int UPDATE_BUFFERS = 200;
+const int UPDATE_FRAMES = 100;
+
+template <class F> double timeMilliseconds(F function) {
+	auto start = std::chrono::steady_clock::now();
+	function();
+	glFinish();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void deleteBuffers(std::vector<GLIds>& buffers) {
+	for (GLIds& ids : buffers) {
+		const GLuint bufferIDs[] = { ids.vertex, ids.normal, ids.texture, ids.index };
+		glDeleteBuffers(4, bufferIDs);
+		glDeleteVertexArrays(1, &ids.vao);
+	}
+	buffers.clear();
+}
+
+int main() {
+	if (!glfwInit()) {
+		fprintf(stderr, "Could not start GLFW\n");
+		return EXIT_FAILURE;
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "buffer_creation_bench", nullptr, nullptr);
+	if (window == nullptr) {
+		fprintf(stderr, "Could not create a GL 4.5 context\n");
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+	gladLoadGL();
+
+	const Mesh mesh = generateSphere(1, 16, 16);
+	PNGImage image;
+	image.width = TEXTURE_SIZE;
+	image.height = TEXTURE_SIZE;
+	image.pixels.resize(TEXTURE_SIZE * TEXTURE_SIZE * 4);
+	for (size_t i = 0; i < image.pixels.size(); i++) {
+		image.pixels[i] = (unsigned char)(i * 7);
+	}
+
+	std::vector<GLIds> buffers;
+	buffers.reserve(MESH_COUNT);
+	std::vector<GLuint> textures(TEXTURE_COUNT);
+
+	// Warm up the driver so the first path doesn't pay for its initialization
+	buffers.push_back(generateMutableBuffer(mesh, true));
+	buffers.push_back(createImmutableBuffer(mesh, true));
+	deleteBuffers(buffers);
+
+	const double mutableBuffers = timeMilliseconds([&]() {
+		for (int i = 0; i < MESH_COUNT; i++) buffers.push_back(generateMutableBuffer(mesh, false));
+	});
+	deleteBuffers(buffers);
+	const double immutableBuffers = timeMilliseconds([&]() {
+		for (int i = 0; i < MESH_COUNT; i++) buffers.push_back(createImmutableBuffer(mesh, false));
+	});
+	deleteBuffers(buffers);
+
+	const double mutableTextures = timeMilliseconds([&]() {
+		for (int i = 0; i < TEXTURE_COUNT; i++) textures[i] = generateMutableTexture(image, GL_RGBA);
+	});
+	glDeleteTextures(TEXTURE_COUNT, textures.data());
+	const double immutableTextures = timeMilliseconds([&]() {
+		for (int i = 0; i < TEXTURE_COUNT; i++) textures[i] = createImmutableTexture(image, GL_RGBA);
+	});
+	glDeleteTextures(TEXTURE_COUNT, textures.data());
+
+	// The bind to edit update is what updateBuffer does without direct state access
+	std::vector<glm::vec2> textureCoordinates = mesh.textureCoordinates;
+	for (int i = 0; i < UPDATE_BUFFERS; i++) buffers.push_back(generateMutableBuffer(mesh, true));
+	const double mutableUpdates = timeMilliseconds([&]() {
+		for (int frame = 0; frame < UPDATE_FRAMES; frame++) {
+			textureCoordinates[0].x = float(frame);
+			for (const GLIds& ids : buffers) {
+				glBindVertexArray(ids.vao);
+				glBindBuffer(GL_ARRAY_BUFFER, ids.texture);
+				glBufferSubData(GL_ARRAY_BUFFER, 0, textureCoordinates.size() * sizeof(glm::vec2), textureCoordinates.data());
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				glBindVertexArray(0);
+			}
+		}
+	});
+	deleteBuffers(buffers);
+	for (int i = 0; i < UPDATE_BUFFERS; i++) buffers.push_back(createImmutableBuffer(mesh, true));
+	const double immutableUpdates = timeMilliseconds([&]() {
+		for (int frame = 0; frame < UPDATE_FRAMES; frame++) {
+			textureCoordinates[0].x = float(frame);
+			for (const GLIds& ids : buffers) {
+				glNamedBufferSubData(ids.texture, 0, textureCoordinates.size() * sizeof(glm::vec2), textureCoordinates.data());
+			}
+		}
+	});
+	deleteBuffers(buffers);
+
+	printf("Renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+	printf("%u vertices per mesh, %ix%i RGBA textures with mipmaps\n", unsigned(mesh.vertices.size()), TEXTURE_SIZE, TEXTURE_SIZE);
+	printf("%-28s %12s %12s\n", "", "mutable", "immutable");
+	printf("%-28s %10.2fus %10.2fus (%.1fx)\n", "create mesh buffers",
+		1000 * mutableBuffers / MESH_COUNT, 1000 * immutableBuffers / MESH_COUNT, mutableBuffers / immutableBuffers);
+	printf("%-28s %10.2fus %10.2fus (%.1fx)\n", "create texture",
+		1000 * mutableTextures / TEXTURE_COUNT, 1000 * immutableTextures / TEXTURE_COUNT, mutableTextures / immutableTextures);
+	printf("%-28s %10.2fus %10.2fus (%.1fx)\n", "update dynamic buffer",
+		1000 * mutableUpdates / (UPDATE_BUFFERS * UPDATE_FRAMES), 1000 * immutableUpdates / (UPDATE_BUFFERS * UPDATE_FRAMES), mutableUpdates / immutableUpdates);
+
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
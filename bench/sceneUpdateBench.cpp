@@ -0,0 +1,82 @@
+// Scaling benchmark of updateNodeTransformations on a wide scene graph, from 1 thread up to
+// the number of hardware threads. Also checks that every thread count produces exactly the
+// same transforms as the serial update.
+#include <sceneGraph.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// A root with many children that each own a small subtree, like gameRoot filled with objects
+const unsigned int ROOT_CHILDREN = 2000;
+const unsigned int SUBTREE_DEPTH = 3;
+const unsigned int SUBTREE_FANOUT = 3;
+const int FRAMES = 30;
+
+std::vector<SceneNodeHandle> nodes;
+
+void buildSubtree(SceneNodeHandle parent, unsigned int depth) {
+	if (depth == 0) return;
+	for (unsigned int i = 0; i < SUBTREE_FANOUT; i++) {
+		SceneNodeHandle node = createSceneNode(i % 2 == 0 ? GEOMETRY : EMPTY, parent);
+		node->setPosition(glm::vec3(float(i), 1, 0));
+		node->setScale(glm::vec3(1, 1 + 0.1f * i, 1));
+		nodes.push_back(node);
+		buildSubtree(node, depth - 1);
+	}
+}
+
+// Touch every node so the whole scene is recomputed each frame
+void animate(int frame) {
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		nodes[i]->setRotation(glm::vec3(0.01f * frame, 0.001f * i, 0));
+	}
+}
+
+double runFrames(unsigned int threads) {
+	setSceneUpdateThreads(threads);
+	double totalMilliseconds = 0;
+	for (int frame = 0; frame < FRAMES; frame++) {
+		animate(frame);
+		auto start = std::chrono::steady_clock::now();
+		updateNodeTransformations();
+		auto end = std::chrono::steady_clock::now();
+		totalMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+	}
+	return totalMilliseconds / FRAMES;
+}
+
+int main() {
+	SceneNodeHandle root = createSceneNode(EMPTY);
+	for (unsigned int i = 0; i < ROOT_CHILDREN; i++) {
+		SceneNodeHandle child = createSceneNode(GEOMETRY, root);
+		child->setPosition(glm::vec3(float(i % 100), 0, float(i / 100)));
+		nodes.push_back(child);
+		buildSubtree(child, SUBTREE_DEPTH);
+	}
+
+	const unsigned int nodeCount = totalChildren(root) + 1;
+	const unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	double serial = runFrames(1);
+	std::vector<glm::mat4> serialWorld = sceneTransforms.world;
+	std::vector<glm::mat3> serialNormal = sceneTransforms.normal;
+
+	printf("Scene update: %u nodes, %i frames\n", nodeCount, FRAMES);
+	printf("%8s %12s %10s %10s\n", "threads", "ms/frame", "speedup", "identical");
+	printf("%8u %12.3f %9.2fx %10s\n", 1u, serial, 1.0, "yes");
+
+	for (unsigned int threads = 2; threads <= maxThreads; threads++) {
+		double parallel = runFrames(threads);
+		// Same final frame as the serial run, so the results must match bit for bit
+		bool identical =
+			std::memcmp(serialWorld.data(), sceneTransforms.world.data(), serialWorld.size() * sizeof(glm::mat4)) == 0
+			&& std::memcmp(serialNormal.data(), sceneTransforms.normal.data(), serialNormal.size() * sizeof(glm::mat3)) == 0;
+		printf("%8u %12.3f %9.2fx %10s\n", threads, parallel, serial / parallel, identical ? "yes" : "NO");
+	}
+
+	setSceneUpdateThreads(1);
+	return 0;
+}
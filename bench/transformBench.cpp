@@ -0,0 +1,101 @@
+// Micro benchmark of the batched transform kernels against the chained glm calls
+// the scene graph used to compose every node transform with.
+#include <utilities/transformKernel.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const unsigned int NODE_COUNT = 100000;
+const int ITERATIONS = 20;
+
+float randomRange(float min, float max) {
+	return min + (max - min) * (float(rand()) / float(RAND_MAX));
+}
+
+glm::vec3 randomVec3(float min, float max) {
+	return glm::vec3(randomRange(min, max), randomRange(min, max), randomRange(min, max));
+}
+
+template <class F> double timeNanosecondsPerNode(F function) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++) {
+		function();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / double(ITERATIONS * NODE_COUNT);
+}
+
+int main() {
+	std::vector<glm::vec3> position(NODE_COUNT);
+	std::vector<glm::vec3> rotation(NODE_COUNT);
+	std::vector<glm::vec3> scale(NODE_COUNT);
+	std::vector<glm::vec3> uniformScale(NODE_COUNT);
+	std::vector<glm::vec3> referencePoint(NODE_COUNT);
+	std::vector<unsigned int> indices(NODE_COUNT);
+
+	for (unsigned int i = 0; i < NODE_COUNT; i++) {
+		position[i] = randomVec3(-100, 100);
+		rotation[i] = randomVec3(-10, 10);
+		scale[i] = randomVec3(0.5f, 3.0f);
+		uniformScale[i] = glm::vec3(scale[i].x);
+		referencePoint[i] = randomVec3(-2, 2);
+		indices[i] = i;
+	}
+
+	std::vector<glm::mat4> glmWorld(NODE_COUNT);
+	std::vector<glm::mat3> glmNormal(NODE_COUNT);
+	std::vector<glm::mat4> kernelWorld(NODE_COUNT);
+	std::vector<glm::mat3> kernelNormal(NODE_COUNT);
+
+	double glmCompose = timeNanosecondsPerNode([&]() {
+		for (unsigned int i = 0; i < NODE_COUNT; i++) {
+			glmWorld[i] =
+				glm::translate(position[i])
+				* glm::translate(referencePoint[i])
+				* glm::rotate(rotation[i].y, glm::vec3(0, 1, 0))
+				* glm::rotate(rotation[i].x, glm::vec3(1, 0, 0))
+				* glm::rotate(rotation[i].z, glm::vec3(0, 0, 1))
+				* glm::scale(scale[i])
+				* glm::translate(-referencePoint[i]);
+		}
+	});
+	double glmNormals = timeNanosecondsPerNode([&]() {
+		for (unsigned int i = 0; i < NODE_COUNT; i++) {
+			glmNormal[i] = glm::transpose(glm::inverse(glm::mat3(glmWorld[i])));
+		}
+	});
+
+	double kernelCompose = timeNanosecondsPerNode([&]() {
+		composeTransforms(indices.data(), NODE_COUNT, position.data(), referencePoint.data(), rotation.data(), scale.data(), kernelWorld.data());
+	});
+	double kernelNormals = timeNanosecondsPerNode([&]() {
+		computeNormalMatrices(indices.data(), NODE_COUNT, kernelWorld.data(), kernelNormal.data());
+	});
+
+	// Largest difference between the two paths, to make sure the kernel is doing the same work
+	float maxError = 0;
+	for (unsigned int i = 0; i < NODE_COUNT; i++) {
+		for (int c = 0; c < 4; c++) {
+			glm::vec4 difference = glm::abs(glmWorld[i][c] - kernelWorld[i][c]);
+			maxError = glm::max(maxError, glm::max(glm::max(difference.x, difference.y), glm::max(difference.z, difference.w)));
+		}
+	}
+
+	composeTransforms(indices.data(), NODE_COUNT, position.data(), referencePoint.data(), rotation.data(), uniformScale.data(), kernelWorld.data());
+	double kernelUniformNormals = timeNanosecondsPerNode([&]() {
+		computeUniformNormalMatrices(indices.data(), NODE_COUNT, kernelWorld.data(), kernelNormal.data());
+	});
+
+	printf("Transform kernel: %s, %u nodes, %i iterations\n", transformKernelName(), NODE_COUNT, ITERATIONS);
+	printf("%-28s %10s %10s\n", "", "glm", "kernel");
+	printf("%-28s %8.2fns %8.2fns (%.1fx)\n", "compose TRS", glmCompose, kernelCompose, glmCompose / kernelCompose);
+	printf("%-28s %8.2fns %8.2fns (%.1fx)\n", "normal matrix", glmNormals, kernelNormals, glmNormals / kernelNormals);
+	printf("%-28s %8.2fns %8.2fns (%.1fx)\n", "normal matrix, uniform", glmNormals, kernelUniformNormals, glmNormals / kernelUniformNormals);
+	printf("Max absolute difference: %g\n", maxError);
+
+	return 0;
+}
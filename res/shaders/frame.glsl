@@ -0,0 +1,21 @@
+// Per frame data, each block is written once per frame to the frame ring buffer.
+// Laid out like CameraData, LightsData and BallData in drawData.hpp, the program defines
+// POINT_LIGHTS when it builds the shader
+
+layout(std140, binding = 0) uniform Camera {
+	mat4 VP;
+	vec4 viewPosition;
+} camera;
+
+layout(std140, binding = 1) uniform Lights {
+	vec4 ambient;
+	vec4 positions[POINT_LIGHTS];
+	vec4 colors[POINT_LIGHTS];
+	// Constant, linear and quadratic attenuation in xyz
+	vec4 attenuation[POINT_LIGHTS];
+} lights;
+
+layout(std140, binding = 2) uniform Ball {
+	vec3 position;
+	float radius;
+} ball;
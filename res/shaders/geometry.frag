@@ -1,22 +1,8 @@
 #version 430 core
-// TODO: find a better way of setting size
-const int POINT_LIGHTS = 3;
-
-struct PointLights {
-	vec3 position[POINT_LIGHTS];
-	vec3 color[POINT_LIGHTS];
-	
-	// Attenuation
-	float constant[POINT_LIGHTS];
-	float linear[POINT_LIGHTS];
-	float quadratic[POINT_LIGHTS]; 
-};
-
-// TODO: position here can be merged with light position for better cache
-struct Ball {
-	vec3 position;
-	float radius;
-};
+// Permutations, defined by the program when it builds the shader:
+// NORMAL_MAPPED samples the diffuse, normal and roughness maps, without it the surface is plain grey.
+// LIGHT_COUNT is how many of the POINT_LIGHTS lights in the Lights block are lit
+#include "frame.glsl"
 
 in layout(location = 1) vec2 textureCoordinates;
 in layout(location = 2) vec3 position;
@@ -26,13 +12,6 @@ layout (binding = 0) uniform sampler2D diffuseSample;
 layout (binding = 1) uniform sampler2D normalSample;
 layout (binding = 2) uniform sampler2D roughnessSample;
 
-uniform vec3 viewPosition;
-uniform PointLights pLights;
-uniform vec3 ambient;
-uniform int isNormalMapped; 
-
-
-uniform Ball ball;
 // TODO: light member, ball member, based on distance between light and ball? 
 const float softRadius = 0.3f;
 
@@ -56,25 +35,26 @@ void main()
 	float shininess;  
 	vec3 normal;
 	vec4 objectColor; 
-	if (isNormalMapped == 1) {
-		normal = texture(normalSample, textureCoordinates).rgb;
-		normal = normalize(normal * 2.0 - 1.0);
-		normal = tbn * normal;
-		// TODO: doesn't really make sense that: normal mapped == color mapped. Maybe rename to isTextureMapped
-		objectColor = texture(diffuseSample, textureCoordinates);
-		shininess = 5 / pow(texture(roughnessSample, textureCoordinates).r, 2);
-	} else {
-		normal = normalize(tbn[2]);
-		objectColor = vec4(0.5, 0.5, 0.5, 1.0);
-		shininess = 32;
-	}
+#ifdef NORMAL_MAPPED
+	// Normal maps may be two channel (BC5), so z is always rebuilt from x and y
+	vec2 tangentNormal = texture(normalSample, textureCoordinates).rg * 2.0 - 1.0;
+	normal = vec3(tangentNormal, sqrt(max(1.0 - dot(tangentNormal, tangentNormal), 0.0)));
+	normal = tbn * normal;
+	// TODO: doesn't really make sense that: normal mapped == color mapped. Maybe rename to isTextureMapped
+	objectColor = texture(diffuseSample, textureCoordinates);
+	shininess = 5 / pow(texture(roughnessSample, textureCoordinates).r, 2);
+#else
+	normal = normalize(tbn[2]);
+	objectColor = vec4(0.5, 0.5, 0.5, 1.0);
+	shininess = 32;
+#endif
 
 
 	// accumulative value for illumination  
-	vec3 illumination = ambient;
-	for (int i = 0; i < POINT_LIGHTS; i++) {
+	vec3 illumination = lights.ambient.xyz;
+	for (int i = 0; i < LIGHT_COUNT; i++) {
 		// Calculate shadow for ball
-		vec3 posLightVec = pLights.position[i] - position;
+		vec3 posLightVec = lights.positions[i].xyz - position;
 		vec3 posBall = position - ball.position;
 		vec3 rejection = reject(posBall, posLightVec); 
 		bool isLightBlocked = length(posLightVec) > length(posBall) && dot(posLightVec, posBall) <= 0;	
@@ -86,17 +66,18 @@ void main()
 
 		// Calculate the attenuation
 		float posLightMagnitude = length(posLightVec);
-		float attenuation = 1 / (pLights.constant[i] + pLights.linear[i] * posLightMagnitude + pLights.quadratic[i] * pow(posLightMagnitude, 2));
+		vec3 coefficients = lights.attenuation[i].xyz;
+		float attenuation = 1 / (coefficients.x + coefficients.y * posLightMagnitude + coefficients.z * pow(posLightMagnitude, 2));
 		
 		vec3 lightDir = normalize(posLightVec); 
 		// calculate cosine of the angle between normal and lightDir
 		float diff = max(dot(normal, lightDir), 0.0); 
-		vec3 diffuse = (diff * pLights.color[i]) * attenuation;
+		vec3 diffuse = (diff * lights.colors[i].xyz) * attenuation;
 		
 		vec3 reflectDir = reflect(-lightDir, normal);  
-		vec3 viewDir = normalize(viewPosition - position);
+		vec3 viewDir = normalize(camera.viewPosition.xyz - position);
 		float spec = max(pow(dot(reflectDir, viewDir), shininess), 0);
-		vec3 specular = (spec * pLights.color[i] * specularIntensity) * attenuation;
+		vec3 specular = (spec * lights.colors[i].xyz * specularIntensity) * attenuation;
 
 		illumination += (diffuse + specular) * objectColor.xyz * shadow;
 	}
@@ -1,13 +1,24 @@
 #version 430 core
+// Packed vertices, see PackedVertex. The normal and tangent are snorm 2_10_10_10 and come in
+// normalized, the texture coordinates are half floats
 in layout(location = 0) vec3 position;
-in layout(location = 1) vec3 normal_in;
+in layout(location = 1) vec4 normal_in;
 in layout(location = 2) vec2 textureCoordinates_in;
-in layout(location = 3) vec3 tangent;
-in layout(location = 4) vec3 bitTangent;
+// w is the handedness of the tangent frame
+in layout(location = 3) vec4 tangent_in;
 
-uniform layout(location = 0) mat4 VP;
-uniform layout(location = 1) mat4 mTransform;
-uniform layout(location = 2) mat3 normalMatrix; // Inverse transpose transform
+#include "frame.glsl"
+// Index of the first instance of this draw in the instance buffer
+uniform layout(location = 1) int instanceOffset;
+
+struct Instance {
+	mat4 transform;
+	mat4 normalMatrix; // Inverse transpose transform, mat3 padded to mat4 columns
+};
+
+layout(std430, binding = 0) readonly buffer Instances {
+	Instance instances[];
+};
 
 out layout(location = 1) vec2 textureCoordinates_out;
 out layout(location = 2) vec3 position_out;
@@ -17,13 +28,18 @@ void main()
 {
 	textureCoordinates_out = vec2(textureCoordinates_in.x , 1.0 - textureCoordinates_in.y);
 	
-	vec4 preProjPos = mTransform * vec4(position, 1.0f);
+	Instance instance = instances[instanceOffset + gl_InstanceID];
+	mat3 normalMatrix = mat3(instance.normalMatrix);
+
+	vec4 preProjPos = instance.transform * vec4(position, 1.0f);
 	position_out = vec3(preProjPos);
 
-	vec3 t = normalize(normalMatrix * tangent);
+	// The bitangent is rebuilt from the normal and tangent instead of being stored
+	vec3 bitTangent = cross(normal_in.xyz, tangent_in.xyz) * tangent_in.w;
+	vec3 t = normalize(normalMatrix * tangent_in.xyz);
 	vec3 b = normalize(normalMatrix * bitTangent);
-	vec3 n = normalize(normalMatrix * normal_in);
+	vec3 n = normalize(normalMatrix * normal_in.xyz);
 	tbn_out = mat3(t, b, n);
 
-	gl_Position = VP * preProjPos;
+	gl_Position = camera.VP * preProjPos;
 }
@@ -0,0 +1,51 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+// Packed vertices, see PackedVertex. The normal and tangent are snorm 2_10_10_10 and come in
+// normalized, the texture coordinates are half floats
+in layout(location = 0) vec3 position;
+in layout(location = 1) vec4 normal_in;
+in layout(location = 2) vec2 textureCoordinates_in;
+// w is the handedness of the tangent frame
+in layout(location = 3) vec4 tangent_in;
+
+#include "frame.glsl"
+// Index of the first command of this glMultiDrawElementsIndirect call, gl_DrawIDARB restarts at 0 every call
+uniform layout(location = 2) int drawOffset;
+
+struct Instance {
+	mat4 transform;
+	mat4 normalMatrix; // Inverse transpose transform, mat3 padded to mat4 columns
+};
+
+layout(std430, binding = 0) readonly buffer Instances {
+	Instance instances[];
+};
+
+// Index of the first instance of every draw command in the instance buffer
+layout(std430, binding = 1) readonly buffer DrawInstanceOffsets {
+	uint drawInstanceOffsets[];
+};
+
+out layout(location = 1) vec2 textureCoordinates_out;
+out layout(location = 2) vec3 position_out;
+out layout(location = 3) mat3 tbn_out;
+
+void main()
+{
+	textureCoordinates_out = vec2(textureCoordinates_in.x , 1.0 - textureCoordinates_in.y);
+	
+	Instance instance = instances[drawInstanceOffsets[drawOffset + gl_DrawIDARB] + gl_InstanceID];
+	mat3 normalMatrix = mat3(instance.normalMatrix);
+
+	vec4 preProjPos = instance.transform * vec4(position, 1.0f);
+	position_out = vec3(preProjPos);
+
+	// The bitangent is rebuilt from the normal and tangent instead of being stored
+	vec3 bitTangent = cross(normal_in.xyz, tangent_in.xyz) * tangent_in.w;
+	vec3 t = normalize(normalMatrix * tangent_in.xyz);
+	vec3 b = normalize(normalMatrix * bitTangent);
+	vec3 n = normalize(normalMatrix * normal_in.xyz);
+	tbn_out = mat3(t, b, n);
+
+	gl_Position = camera.VP * preProjPos;
+}
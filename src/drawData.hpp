@@ -0,0 +1,89 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "utilities/uniformBlocks.hpp"
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Layouts of the data the geometry shaders read from the frame ring buffer.
+// Keep these in sync with the blocks in frame.glsl, geometry.vert and geometry_mdi.vert.
+// The uniform blocks are also compared against the programs when they are linked, see checkUniformBlock.
+
+// Size of the light arrays, the geometry shaders are built with the same value defined
+#define POINT_LIGHTS 3
+
+// Binding points of the blocks
+const GLuint CAMERA_BINDING = 0;				// uniform Camera
+const GLuint LIGHTS_BINDING = 1;				// uniform Lights
+const GLuint BALL_BINDING = 2;					// uniform Ball
+const GLuint INSTANCES_BINDING = 0;				// buffer Instances
+const GLuint DRAW_INSTANCE_OFFSETS_BINDING = 1;	// buffer DrawInstanceOffsets
+
+// Explicit locations of the uniforms that change between draws
+const GLint INSTANCE_OFFSET_LOCATION = 1;		// geometry.vert
+const GLint DRAW_OFFSET_LOCATION = 2;			// geometry_mdi.vert
+const GLint MP_LOCATION = 3;					// geometry_2D.vert
+
+// std140 `Camera` block
+struct CameraData {
+	glm::mat4 viewProjection;
+	glm::vec4 viewPosition;
+};
+
+// std140 `Lights` block. std140 pads every array element to a vec4, so the
+// constant, linear and quadratic attenuation of a light share one vec4 in xyz
+struct LightsData {
+	glm::vec4 ambient;
+	glm::vec4 positions[POINT_LIGHTS];
+	glm::vec4 colors[POINT_LIGHTS];
+	glm::vec4 attenuation[POINT_LIGHTS];
+};
+
+// std140 `Ball` block, the radius fills the padding after the vec3
+struct BallData {
+	glm::vec3 position;
+	float radius;
+};
+
+// The offsets std140 gives the members of the blocks
+static_assert(offsetof(CameraData, viewPosition) == 64 && sizeof(CameraData) == 80, "CameraData does not match the std140 Camera block");
+static_assert(offsetof(LightsData, positions) == 16
+	&& offsetof(LightsData, colors) == 16 + 16 * POINT_LIGHTS
+	&& offsetof(LightsData, attenuation) == 16 + 32 * POINT_LIGHTS
+	&& sizeof(LightsData) == 16 + 48 * POINT_LIGHTS, "LightsData does not match the std140 Lights block");
+static_assert(offsetof(BallData, radius) == 12 && sizeof(BallData) == 16, "BallData does not match the std140 Ball block");
+
+const UniformBlockMember CAMERA_MEMBERS[] = {
+	{ "VP", offsetof(CameraData, viewProjection), 0 },
+	{ "viewPosition", offsetof(CameraData, viewPosition), 0 },
+};
+const UniformBlockMember LIGHTS_MEMBERS[] = {
+	{ "ambient", offsetof(LightsData, ambient), 0 },
+	{ "positions", offsetof(LightsData, positions), sizeof(glm::vec4) },
+	{ "colors", offsetof(LightsData, colors), sizeof(glm::vec4) },
+	{ "attenuation", offsetof(LightsData, attenuation), sizeof(glm::vec4) },
+};
+const UniformBlockMember BALL_MEMBERS[] = {
+	{ "position", offsetof(BallData, position), 0 },
+	{ "radius", offsetof(BallData, radius), 0 },
+};
+
+const UniformBlockLayout FRAME_BLOCKS[] = {
+	{ "Camera", CAMERA_BINDING, sizeof(CameraData), CAMERA_MEMBERS, sizeof(CAMERA_MEMBERS) / sizeof(CAMERA_MEMBERS[0]) },
+	{ "Lights", LIGHTS_BINDING, sizeof(LightsData), LIGHTS_MEMBERS, sizeof(LIGHTS_MEMBERS) / sizeof(LIGHTS_MEMBERS[0]) },
+	{ "Ball", BALL_BINDING, sizeof(BallData), BALL_MEMBERS, sizeof(BALL_MEMBERS) / sizeof(BALL_MEMBERS[0]) },
+};
+
+// Everything written to the blocks for a frame, each block is one write to the frame ring buffer
+struct FrameData {
+	CameraData camera;
+	LightsData lights;
+	BallData ball;
+};
+
+// std430 `Instance` struct.
+// The normal matrix is stored with mat4 columns since std430 pads mat3 columns to vec4 anyway
+struct InstanceData {
+	glm::mat4 transform;
+	glm::mat4 normalMatrix;
+};
@@ -1,5 +1,6 @@
 #include <chrono>
 #include <algorithm>
+#include <thread>
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 #include <SFML/Audio/SoundBuffer.hpp>
@@ -10,13 +11,20 @@
 #include <utilities/mesh.h>
 #include <utilities/shapes.h>
 #include <utilities/glutils.h>
+#include <utilities/geometryHeap.hpp>
+#include <utilities/meshRegistry.hpp>
+#include <utilities/textureStreamer.hpp>
 #include <SFML/Audio/Sound.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <fmt/format.h>
 #include "gamelogic.h"
 #include "sceneGraph.hpp"
-#include "utilities/shaderVariables.hpp"
+#include "sceneFile.hpp"
+#include "stressScene.hpp"
+#include "renderQueue.hpp"
+#include "drawData.hpp"
+#include "utilities/ringBuffer.hpp"
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/transform.hpp>
 
@@ -27,23 +35,17 @@
 
 #include <timestamps.h>
 
-#define POINT_LIGHTS 3
-
-const glm::mat4 identity = glm::mat4(1.0f);
-
 // Global ambient for phong shading
 glm::vec3 ambient = glm::vec3(0.05f, 0.05f, 0.05f);
 
 // SOA point light struct, because it makes it easier to integrate with 
-// the scene graph code and to send multiple member data (and less system calls)
+// the scene graph code and to copy each member into the Lights block
 struct PointLights {
-	SceneNode* nodes[POINT_LIGHTS];
+	SceneNodeHandle nodes[POINT_LIGHTS];
 	glm::vec3 color[POINT_LIGHTS];
 
-	// Attenuation 
-	float constant[POINT_LIGHTS];
-	float linear[POINT_LIGHTS];
-	float quadratic[POINT_LIGHTS];
+	// Constant, linear and quadratic attenuation in xyz, like the Lights block
+	glm::vec4 attenuation[POINT_LIGHTS];
 } pointLights;
 
 double padPositionX = 0;
@@ -52,30 +54,37 @@ double padPositionZ = 0;
 unsigned int currentKeyFrame = 0;
 unsigned int previousKeyFrame = 0;
 
-SceneNode* rootNode;
+SceneNodeHandle rootNode;
+
+// Nodes and meshes of res/scenes/glowbox.scene
+LoadedScene gameScene;
 
-SceneNode* gameRoot;
-SceneNode* boxNode;
-SceneNode* ballNode;
-SceneNode* padNode;
+SceneNodeHandle gameRoot;
+SceneNodeHandle boxNode;
+SceneNodeHandle ballNode;
+SceneNodeHandle padNode;
 
 // Text nodes
-SceneNode* uiRoot;
-SceneNode* scoreTextNode;
-SceneNode* instructionTextNode;
+SceneNodeHandle uiRoot;
+SceneNodeHandle scoreTextNode;
+SceneNodeHandle instructionTextNode;
 
 double ballRadius = 3.0f;
+// Radius of the ball mesh, the shadow of the ball is this wide
+float ballMeshRadius = 0;
 
 // These are heap allocated, because they should not be initialised at the start of the program
 sf::SoundBuffer* buffer;
-Gloom::Shader* geometryShader;
+// One geometry program per shader variant, the variants the scene does not use are not built
+Gloom::Shader* geometryShaders[ShaderVariant::MAX_VARIANTS];
 Gloom::Shader* geometry2DShader;
 sf::Sound* sound;
 
-const glm::vec3 boxDimensions(180, 90, 90);
-const glm::vec3 padDimensions(30, 3, 40);
+// Size of the pad mesh, read from the scene file
+glm::vec3 padDimensions;
 
-glm::vec3 ballPosition(0, ballRadius + padDimensions.y, boxDimensions.z / 2);
+// Placed on the pad before the game starts
+glm::vec3 ballPosition;
 glm::vec3 ballDirection(1, 1, 0.2f);
 
 CommandLineOptions options;
@@ -106,15 +115,51 @@ double lastMouseY = windowHeight / 2;
 //	     good location to keep this.
 glm::mat4 pers_projection;
 glm::mat4 orth_projection;
+const float farPlane = 350.f;
 // the camera projection and transformation (VP)
 glm::mat4 vpMat;
 glm::mat4 cameraTransform;
-
-// TODO: maybe use std::array or something less hacky
-// array of all geometry shader variable locations
-GLint geometryVars[MAX_GEOMETRY_VARS];
-GLint geometry2DVars[MAX_GEOMETRY2D_VARS];
-
+// Level of detail is picked so the simplification stays below a pixel
+LODSettings lodSettings;
+
+RenderQueue renderQueue;
+// Frame data, instances and draw commands of the frames in flight
+FrameRingBuffer frameRing;
+
+// All 3D meshes share the buffers of the geometry heap. With ARB_shader_draw_parameters a run of
+// batches using the same material is drawn with one glMultiDrawElementsIndirect, otherwise every
+// batch is drawn on its own from the heap
+GeometryHeap geometryHeap;
+// Every mesh in the heap is requested through the registry, so nodes using the same mesh share it
+MeshRegistry meshRegistry(geometryHeap);
+// Scene textures are decoded on the streamer workers and bound as placeholders until they are uploaded
+TextureStreamer textureStreamer;
+const size_t TEXTURE_STAGING_SIZE = 32 * 1024 * 1024;
+const unsigned int TEXTURE_WORKERS = 2;
+// Uploads per frame are limited to roughly this many bytes to keep the frame time even while streaming
+const size_t TEXTURE_UPLOAD_BUDGET = 8 * 1024 * 1024;
+bool multiDrawIndirect = false;
+std::vector<DrawElementsIndirectCommand> drawCommands;
+std::vector<GLuint> drawInstanceOffsets;
+
+// Lit lights of the game scene, the geometry variants are built for this many
+unsigned int lightCount = 0;
+static_assert(POINT_LIGHTS <= ShaderVariant::MAX_LIGHT_COUNT, "The shader variants can not count all the lights");
+
+
+// Start building the geometry program of a variant, the defines select its permutation
+void buildGeometryVariant(uint8_t variant) {
+	Gloom::ShaderDefines defines = {
+		{ "POINT_LIGHTS", std::to_string(POINT_LIGHTS) },
+		{ "LIGHT_COUNT", std::to_string(ShaderVariant::lightCount(variant)) },
+	};
+	if (ShaderVariant::normalMapped(variant)) {
+		defines.push_back({ "NORMAL_MAPPED", "1" });
+	}
+	geometryShaders[variant] = new Gloom::Shader();
+	geometryShaders[variant]->makeBasicShaderAsync(multiDrawIndirect ? "../res/shaders/geometry_mdi.vert" : "../res/shaders/geometry.vert",
+		"../res/shaders/geometry.frag", defines);
+}
 
 void updateScore(int addition) {
 	static int score;
@@ -123,10 +168,6 @@ void updateScore(int addition) {
 	updateBuffer(scoreTextIds.vao, scoreTextIds.texture, scoreText.mesh.textureCoordinates);
 }
 
-inline bool bitMask(int a, int b) {
-	return ((int)a & b) > 0;
-}
-
 void mouseCallback(GLFWwindow* window, const double x, const double y) {
 	int windowWidth, windowHeight;
 	glfwGetWindowSize(window, &windowWidth, &windowHeight);
@@ -147,6 +188,15 @@ void mouseCallback(GLFWwindow* window, const double x, const double y) {
 }
 
 void initGame(GLFWwindow* window, const CommandLineOptions gameOptions) {
+	// The shaders build on the driver's threads while the music, scene and textures load
+	if (GLAD_GL_KHR_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+	// gl_DrawIDARB is needed to find the instances of each draw in a multi draw
+	multiDrawIndirect = GLAD_GL_ARB_shader_draw_parameters;
+	geometry2DShader = new Gloom::Shader();
+	geometry2DShader->makeBasicShaderAsync("../res/shaders/geometry_2D.vert", "../res/shaders/geometry_2D.frag");
+
 	buffer = new sf::SoundBuffer();
 	if (!buffer->loadFromFile("../res/Hall of the Mountain King.ogg")) {
 		return;
@@ -157,129 +207,53 @@ void initGame(GLFWwindow* window, const CommandLineOptions gameOptions) {
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
 	glfwSetCursorPosCallback(window, mouseCallback);
 
-	geometryShader = new Gloom::Shader();
-	geometryShader->makeBasicShader("../res/shaders/geometry.vert", "../res/shaders/geometry.frag");
-	initializeGeomtryVariables(geometryShader->get(), geometryVars);
-
-	geometry2DShader = new Gloom::Shader();
-	geometry2DShader->makeBasicShader("../res/shaders/geometry_2D.vert", "../res/shaders/geometry_2D.frag");
-	initializeGeomtry2DVariables(geometry2DShader->get(), geometry2DVars);
-
-	float radius = 1.0f;
-
-	// Create meshes
-	Mesh pad = cube(padDimensions, glm::vec2(30, 40), true);
-	Mesh sphere = generateSphere(radius, 40, 40);
-
-	// Fill buffers
-	unsigned int ballVAO = generateBuffer(sphere, false).vao;
-	unsigned int padVAO = generateBuffer(pad, false).vao;
-
 	// Construct scene
+	setSceneUpdateThreads(std::thread::hardware_concurrency());
 	rootNode = createSceneNode(EMPTY);
-	gameRoot = createSceneNode(EMPTY);
-	uiRoot = createSceneNode(EMPTY);
-
-	rootNode->children.push_back(gameRoot);
-	rootNode->children.push_back(uiRoot);
-
-	padNode = createSceneNode(GEOMETRY);
-	ballNode = createSceneNode(GEOMETRY);
-
-	gameRoot->children.push_back(padNode);
-	gameRoot->children.push_back(ballNode);
-
-
-	padNode->vertexArrayObjectID = padVAO;
-	padNode->VAOIndexCount = pad.indices.size();
-
-	ballNode->vertexArrayObjectID = ballVAO;
-	ballNode->VAOIndexCount = sphere.indices.size();
-	
-	{	
-		Mesh box = cube(boxDimensions, glm::vec2(90), true, true);
-		GLIds boxIDs = generateBuffer(box, false);
-		boxNode = createSceneNode(GEOMETRY_NORMAL_MAPPED);
-		boxNode->vertexArrayObjectID = boxIDs.vao;
-		boxNode->VAOIndexCount = box.indices.size();
-
-		PNGImage brickNormals = loadPNGFile("../res/textures/Brick03_nrm.png");
-		GLint brickNormalsID = generateTexture(brickNormals, GL_RGBA);
-		boxNode->normalMapID = brickNormalsID;
-
-		PNGImage brickColor = loadPNGFile("../res/textures/Brick03_col.png");
-		GLint brickColorID = generateTexture(brickColor, GL_RGBA);
-		boxNode->diffuseID = brickColorID;
-
-		PNGImage brickRoughness = loadPNGFile("../res/textures/Brick03_rgh.png");
-		GLint brickbrickRoughnessID = generateTexture(brickRoughness, GL_R8);
-		boxNode->roughnessID = brickbrickRoughnessID;
+	setSceneRoot(rootNode);
+	gameRoot = createSceneNode(EMPTY, rootNode);
+	uiRoot = createSceneNode(EMPTY, rootNode);
+
+	textureStreamer.create(TEXTURE_STAGING_SIZE, TEXTURE_WORKERS);
+	if (!loadScene("../res/scenes/glowbox.scene", gameRoot, meshRegistry, textureStreamer, gameScene)) {
+		fprintf(stderr, "Could not load the game scene\n");
+		exit(EXIT_FAILURE);
+	}
+	boxNode = gameScene.find("box");
+	padNode = gameScene.find("pad");
+	ballNode = gameScene.find("ball");
+	assert(!boxNode.isNull() && !padNode.isNull() && !ballNode.isNull() && "The game scene is missing a node");
+	assert(gameScene.lights.size() <= POINT_LIGHTS && "The game scene has too many lights");
 
-		gameRoot->children.push_back(boxNode);
+	// The geometry variants depend on the lights of the scene, they build while the text loads
+	lightCount = unsigned(gameScene.lights.size());
+	buildGeometryVariant(ShaderVariant::make(false, lightCount));
+	buildGeometryVariant(ShaderVariant::make(true, lightCount));
 
-		appendTBNBuffer(box, &boxIDs);
-	}
+	// The game logic moves the pad inside the box, so it needs the size of the mesh
+	padDimensions = geometryHeap.mesh(padNode->meshID).bounds.box.extents() * 2.0f;
+	ballMeshRadius = geometryHeap.mesh(ballNode->meshID).bounds.sphere.radius;
 
 	{
-		for (int i = 0; i < POINT_LIGHTS; i++) {
-			pointLights.nodes[i] = createSceneNode(POINT_LIGHT);
-			pointLights.constant[i] = 1;
-
-			// Add light 0 and 1 as child of the pad and the ball node
-			switch (i) {
-			case 0:
-				pointLights.color[i] = glm::vec3(1, 0, 0);
-
-				pointLights.linear[i] = 0.002;
-				pointLights.quadratic[i] = 0.0002;
-
-				// Move pad light to avoid direct collision with ball (which would make things wonky)
-				pointLights.nodes[i]->position = glm::vec3(0, 2, 0);
-				padNode->children.push_back(pointLights.nodes[i]);
-				break;
-			case 1:
-				// offset the light so it can cast proper shadows 
-				pointLights.nodes[i]->position = glm::vec3(1, 1, 1);
-				pointLights.color[i] = glm::vec3(0, 1, 0);
-
-				pointLights.linear[i] = 0.005;
-				pointLights.quadratic[i] = 0.0005;
-				ballNode->children.push_back(pointLights.nodes[i]);
-				break;
-			default:
-				// TODO: Random noise so that adding more than three lights will result in more interesting output
-				pointLights.color[i] = glm::vec3(0, 0, 1);
-				pointLights.linear[i] = 0.01;
-				pointLights.quadratic[i] = 0.001;
-				pointLights.nodes[i]->position = glm::vec3(0, -10, -80);
-				gameRoot->children.push_back(pointLights.nodes[i]);
-				break;
-			}
+		// The text is built on the first frame, so the character map is loaded right away instead of streamed
+		MappedFile charmap;
+		if (!openTextureFile("../res/textures/charmap.png", TEXTURE_FILE_RGBA8, charmap)) {
+			fprintf(stderr, "Could not load the character map\n");
+			exit(EXIT_FAILURE);
 		}
-		geometryShader->activate();
-		glUniform1fv(geometryVars[PL_CONSTANT], POINT_LIGHTS, pointLights.constant);
-		glUniform1fv(geometryVars[PL_LINEAR], POINT_LIGHTS, pointLights.linear);
-		glUniform1fv(geometryVars[PL_QUADRATIC], POINT_LIGHTS, pointLights.quadratic);
-		glUniform1f(geometryVars[BALL_RADIUS], radius);
-		geometryShader->deactivate();
-	}
-
-	{
-		PNGImage charmap = loadPNGFile("../res/textures/charmap.png");
-		GLint charMapId = generateTexture(charmap, GL_RGBA);
+		GLint charMapId = generateTexture(charmap);
 
 		{
 			// Create test text node, max score of 99999999 and min of -9999999
 			std::string scoreTemplate = "score: xxxxxxxx";
 			scoreText = generateTextGeometryBuffer(scoreTemplate, 39 / 29, scoreTemplate.length() * 29);
 			scoreTextIds = generateBuffer(scoreText.mesh, true);
-			scoreTextNode = createSceneNode(GEOMETRY_2D);
+			scoreTextNode = createSceneNode(GEOMETRY_2D, uiRoot);
 			scoreTextNode->vertexArrayObjectID = scoreTextIds.vao;
 			scoreTextNode->VAOIndexCount = scoreText.mesh.indices.size();
-			scoreTextNode->position = glm::vec3(0, 0, 0);
+			scoreTextNode->setPosition(glm::vec3(0, 0, 0));
 			scoreTextNode->diffuseID = charMapId;
 
-			uiRoot->children.push_back(scoreTextNode);
 			// Update score text to 0 in UI (will be 'xxxxxxxx' otherwise)
 			updateScore(0);
 		}
@@ -290,26 +264,61 @@ void initGame(GLFWwindow* window, const CommandLineOptions gameOptions) {
 			float totalWidth = instrText.length() * 29;
 			TextMesh instrMesh = generateTextGeometryBuffer(instrText, 39 / 29, totalWidth);
 			GLuint instrVao = generateBuffer(instrMesh.mesh, false).vao;
-			instructionTextNode = createSceneNode(GEOMETRY_2D);
+			instructionTextNode = createSceneNode(GEOMETRY_2D, uiRoot);
 			instructionTextNode->vertexArrayObjectID = instrVao;
 			instructionTextNode->VAOIndexCount = instrMesh.mesh.indices.size();
 			// Place text at the middle of the screen
 			float xPosition = totalWidth * 0.5 / windowWidth;
-			instructionTextNode->position = glm::vec3(xPosition, 1, 0);
+			instructionTextNode->setPosition(glm::vec3(xPosition, 1, 0));
 			instructionTextNode->diffuseID = charMapId;
+		}
+	}
+
+	for (unsigned int i = 0; i < lightCount; i++) {
+		const SceneLight& light = gameScene.lights[i];
+		pointLights.nodes[i] = light.node;
+		pointLights.color[i] = light.color;
+		pointLights.attenuation[i] = glm::vec4(light.constant, light.linear, light.quadratic, 0);
+	}
 
-			uiRoot->children.push_back(instructionTextNode);
+	// Wait for the programs and make sure the blocks they read match the structs written to them
+	geometry2DShader->finish();
+	for (Gloom::Shader* shader : geometryShaders) {
+		if (shader == nullptr) continue;
+		shader->finish();
+		bool valid = true;
+		for (const UniformBlockLayout& block : FRAME_BLOCKS) {
+			valid &= checkUniformBlock(shader->get(), block);
 		}
+		assert(valid && "A uniform block of the geometry shader does not match its struct");
 	}
 	
 	// currently the application can't change window size, so we only construct this in setup. 
 	// glfw support listening to window resize so we could move this there if we ever support it
 	// Keep in mind that text should be regenerated on resize
-	pers_projection = glm::perspective(glm::radians(80.0f), float(windowWidth) / float(windowHeight), 0.1f, 350.f);
+	pers_projection = glm::perspective(glm::radians(80.0f), float(windowWidth) / float(windowHeight), 0.1f, farPlane);
 	orth_projection = glm::ortho(0.0f, float(windowWidth), 0.0f, float(windowHeight), -1.0f, 1.0f);
+
+	// The first updateFrame reads the world bounds of the box
+	updateNodeTransformations();
+
+	if (options.enableStressTest) {
+		StressSettings settings;
+		settings.nodes = options.stressNodes;
+		settings.depth = options.stressDepth;
+		settings.fanout = options.stressFanout;
+		settings.dynamicRatio = options.stressDynamicRatio;
+		settings.frames = options.stressFrames;
+		settings.reportPath = options.stressReport;
+		int stressMesh = meshRegistry.acquireCube();
+		buildStressScene(gameRoot, boxNode->getWorldBounds(), stressMesh, geometryHeap.mesh(stressMesh).bounds, settings);
+	}
 	getTimeDeltaSeconds();
 
 	std::cout << fmt::format("Initialized scene with {} SceneNodes.", totalChildren(rootNode)) << std::endl;
+	const MeshRegistryStats meshStats = meshRegistry.stats();
+	std::cout << fmt::format("{} meshes with {} references, {:.1f} KiB resident, {:.1f} KiB saved by sharing.",
+		meshStats.meshes, meshStats.references, meshStats.residentBytes / 1024.0, meshStats.sharedBytes / 1024.0) << std::endl;
 
 	std::cout << "Ready. Click to start!" << std::endl;
 }
@@ -317,18 +326,34 @@ void initGame(GLFWwindow* window, const CommandLineOptions gameOptions) {
 void updateFrame(GLFWwindow* window) {
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
+	if (options.enableStressTest && endStressFrame()) {
+		glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
 	double timeDelta = getTimeDeltaSeconds();
 
-	const float ballBottomY = boxNode->position.y - (boxDimensions.y / 2) + ballRadius + padDimensions.y;
-	const float ballTopY = boxNode->position.y + (boxDimensions.y / 2) - ballRadius;
+	// The box is inverted, so its bounds are the inside walls
+	const AABB& box = boxNode->getWorldBounds();
+	const glm::vec3 boxSize = box.max - box.min;
+
+	// Where the pad sits for the current pad position, which autoplay may still change this frame
+	auto padCenter = [&]() {
+		return glm::vec3(
+			box.min.x + (padDimensions.x / 2) + (1 - padPositionX) * (boxSize.x - padDimensions.x),
+			box.min.y + (padDimensions.y / 2),
+			box.min.z + (padDimensions.z / 2) + (1 - padPositionZ) * (boxSize.z - padDimensions.z));
+	};
+
+	const float ballBottomY = box.min.y + ballRadius + padDimensions.y;
+	const float ballTopY = box.max.y - ballRadius;
 	const float BallVerticalTravelDistance = ballTopY - ballBottomY;
 
 	const float cameraWallOffset = 30; // Arbitrary addition to prevent ball from going too much into camera
 
-	const float ballMinX = boxNode->position.x - (boxDimensions.x / 2) + ballRadius;
-	const float ballMaxX = boxNode->position.x + (boxDimensions.x / 2) - ballRadius;
-	const float ballMinZ = boxNode->position.z - (boxDimensions.z / 2) + ballRadius;
-	const float ballMaxZ = boxNode->position.z + (boxDimensions.z / 2) - ballRadius - cameraWallOffset;
+	const float ballMinX = box.min.x + ballRadius;
+	const float ballMaxX = box.max.x - ballRadius;
+	const float ballMinZ = box.min.z + ballRadius;
+	const float ballMaxZ = box.max.z - ballRadius - cameraWallOffset;
 
 	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_1)) {
 		mouseLeftPressed = true;
@@ -352,7 +377,7 @@ void updateFrame(GLFWwindow* window) {
 		if (mouseLeftPressed) {
 
 			// Remove instruction on how to start game
-			uiRoot->children.erase(std::remove(uiRoot->children.begin(), uiRoot->children.end(), instructionTextNode), uiRoot->children.end());
+			removeChild(uiRoot, instructionTextNode);
 
 			if (options.enableMusic) {
 				sound = new sf::Sound();
@@ -375,7 +400,7 @@ void updateFrame(GLFWwindow* window) {
 		if (hasLost) {
 
 			// Add instruction on how to restart
-			uiRoot->children.push_back(instructionTextNode);
+			addChild(uiRoot, instructionTextNode);
 
 			if (mouseLeftReleased) {
 				hasLost = false;
@@ -469,15 +494,11 @@ void updateFrame(GLFWwindow* window) {
 			// Check if the ball is hitting the pad when the ball is at the bottom.
 			// If not, you just lost the game! (hehe)
 			if (jumpedToNextFrame && currentOrigin == BOTTOM && currentDestination == TOP) {
-				double padLeftX = boxNode->position.x - (boxDimensions.x / 2) + (1 - padPositionX) * (boxDimensions.x - padDimensions.x);
-				double padRightX = padLeftX + padDimensions.x;
-				double padFrontZ = boxNode->position.z - (boxDimensions.z / 2) + (1 - padPositionZ) * (boxDimensions.z - padDimensions.z);
-				double padBackZ = padFrontZ + padDimensions.z;
-
-				if (ballPosition.x < padLeftX
-					|| ballPosition.x > padRightX
-					|| ballPosition.z < padFrontZ
-					|| ballPosition.z > padBackZ) {
+				// The pad is hit when the ball center is above it. The pad node is only moved at the end of
+				// the frame, so its world bounds would lag behind the pad position
+				const glm::vec3 pad = padCenter();
+				if (std::abs(ballPosition.x - pad.x) > padDimensions.x / 2
+					|| std::abs(ballPosition.z - pad.z) > padDimensions.z / 2) {
 					hasLost = true;
 					updateScore(-50);
 					if (options.enableMusic) {
@@ -504,99 +525,187 @@ void updateFrame(GLFWwindow* window) {
 	vpMat = pers_projection * cameraTransform;
 
 	// Move and rotate various SceneNodes
-	boxNode->position = { 0, -10, -80 };
+	ballNode->setPosition(ballPosition);
+	ballNode->setScale(glm::vec3(ballRadius));
+	ballNode->setRotation({ 0, totalElapsedTime * 2, 0 });
 
-	ballNode->position = ballPosition;
-	ballNode->scale = glm::vec3(ballRadius);
-	ballNode->rotation = { 0, totalElapsedTime * 2, 0 };
+	padNode->setPosition(padCenter());
 
-	padNode->position = {
-		boxNode->position.x - (boxDimensions.x / 2) + (padDimensions.x / 2) + (1 - padPositionX) * (boxDimensions.x - padDimensions.x),
-		boxNode->position.y - (boxDimensions.y / 2) + (padDimensions.y / 2),
-		boxNode->position.z - (boxDimensions.z / 2) + (padDimensions.z / 2) + (1 - padPositionZ) * (boxDimensions.z - padDimensions.z)
-	};
+	if (options.enableStressTest) {
+		animateStressScene(glfwGetTime());
+	}
 
-	updateNodeTransformations(rootNode, identity);
+	StressTime phaseStart = stressNow();
+	updateNodeTransformations();
+	recordStressPhase(PHASE_TRANSFORM, phaseStart);
 }
 
-void updateNodeTransformations(SceneNode* node, const glm::mat4& transformationThusFar) {
-	glm::mat4 transformationMatrix =
-		glm::translate(node->position)
-		* glm::translate(node->referencePoint)
-		* glm::rotate(node->rotation.y, glm::vec3(0, 1, 0))
-		* glm::rotate(node->rotation.x, glm::vec3(1, 0, 0))
-		* glm::rotate(node->rotation.z, glm::vec3(0, 0, 1))
-		* glm::scale(node->scale)
-		* glm::translate(-node->referencePoint);
-
-	node->currentTransformationMatrix = transformationThusFar * transformationMatrix;
-
-	if (bitMask(node->nodeType, GEOMETRY | GEOMETRY_NORMAL_MAPPED)) {
-		// Calculate the normal transformation
-		glm::mat3 rotationAndScale = glm::mat3(node->currentTransformationMatrix);
-		node->normalMatrix = glm::transpose(glm::inverse(rotationAndScale));
+// Queue a draw item for every 3D node of a layer that survived culling, at the level of detail its distance allows
+void queueGeometryLayer(RenderLayer layer, bool normalMapped) {
+	for (SceneNode* node : renderLayers[layer]) {
+		if (node->meshID == -1 || node->isCulled()) continue;
+		const HeapMesh& mesh = geometryHeap.mesh(node->meshID);
+		const unsigned int lod = selectNodeLOD(*node, mesh.lodErrors, mesh.lodCount, lodSettings);
+		Material material = { node->diffuseID, node->normalMapID, node->roughnessID };
+		// w of the clip position is the distance along the view direction, normalize it by the far plane
+		glm::vec4 clipPosition = vpMat * node->getTransformationMatrix()[3];
+		uint32_t depth = SortKey::depth(clipPosition.w / farPlane);
+		// Every 3D mesh shares the heap VAO, so the mesh and its level of detail decide which items can be instanced together
+		renderQueue.push(SortKey::make(PASS_GEOMETRY, ShaderVariant::make(normalMapped, lightCount), renderQueue.materialID(material),
+			node->meshID * MAX_MESH_LODS + lod, depth), node);
 	}
+}
 
-	for (SceneNode* child : node->children) {
-		updateNodeTransformations(child, node->currentTransformationMatrix);
+void queueUILayer() {
+	for (const SceneNode* node : renderLayers[LAYER_UI]) {
+		if (node->vertexArrayObjectID == -1) continue;
+		// TODO: default to an error texture if ID is not set
+		Material material = { node->diffuseID, 0, 0 };
+		// UI is blended, so it is drawn in tree order instead of being grouped by material. The layer order is
+		// arbitrary, but the transform entries are in tree order after updateNodeTransformations
+		renderQueue.push(SortKey::makeOrdered(PASS_GEOMETRY_2D, node->transformIndex, 0, renderQueue.materialID(material), node->vertexArrayObjectID), node);
 	}
 }
 
-// should be called from renderFrame or self, or make sure to set vpLocation to current VP
-void renderNode(const SceneNode* node, int renderBitmask) {
-	if (bitMask(node->nodeType, renderBitmask)) {
-		switch (node->nodeType) {
-		case GEOMETRY_NORMAL_MAPPED:
-			if (node->vertexArrayObjectID == -1) break;
-			glBindVertexArray(node->vertexArrayObjectID);
-			glUniform1i(geometryVars[IS_NORMAL_MAPPED], GL_TRUE);
-			glUniformMatrix4fv(geometryVars[TRANSFORM], 1, GL_FALSE, glm::value_ptr(node->currentTransformationMatrix));
-			glUniformMatrix3fv(geometryVars[NORMAL_MATRIX], 1, GL_FALSE, glm::value_ptr(node->normalMatrix));
-			glBindTextureUnit(0, node->diffuseID);
-			glBindTextureUnit(1, node->normalMapID);
-			glBindTextureUnit(2, node->roughnessID);
-			glDrawElements(GL_TRIANGLES, node->VAOIndexCount, GL_UNSIGNED_INT, nullptr);
-			glBindTextureUnit(0, 0);
-			glBindTextureUnit(1, 0);
-			glBindTextureUnit(2, 0);
-			glBindVertexArray(0);
-			break;
-		case GEOMETRY:
-			if (node->vertexArrayObjectID == -1) break;
-			glBindVertexArray(node->vertexArrayObjectID);
-			glUniform1i(geometryVars[IS_NORMAL_MAPPED], GL_FALSE);
-			glUniformMatrix4fv(geometryVars[TRANSFORM], 1, GL_FALSE, glm::value_ptr(node->currentTransformationMatrix));
-			glUniformMatrix3fv(geometryVars[NORMAL_MATRIX], 1, GL_FALSE, glm::value_ptr(node->normalMatrix));
-			glDrawElements(GL_TRIANGLES, node->VAOIndexCount, GL_UNSIGNED_INT, nullptr);
-			glBindVertexArray(0);
-			break;
-		case GEOMETRY_2D:
-			if (node->vertexArrayObjectID == -1) break;
-			glm::mat4 mp = node->currentTransformationMatrix * orth_projection;
-			glBindVertexArray(node->vertexArrayObjectID);
-			glUniformMatrix4fv(geometry2DVars[MP], 1, GL_FALSE, glm::value_ptr(mp));
-			// TODO: default to an error texture if ID is not set
-			// currently only use one texture unit (0)
-			glBindTextureUnit(0, node->diffuseID);
+// Submit the sorted queue one batch at a time, only changing GL state when it differs from the previous batch.
+// Everything the draws read is written to the frame ring buffer first.
+void submitRenderQueue(const FrameData& frame) {
+	// The instanced pass sorts first, so the instance of item i is at index i in the instance buffer
+	// and the draw command of batch i is at index i in drawCommands
+	size_t instanceCount = 0;
+	while (instanceCount < renderQueue.items.size() && isInstancedPass(SortKey::pass(renderQueue.items[instanceCount].key))) {
+		instanceCount++;
+	}
+
+	drawCommands.clear();
+	drawInstanceOffsets.clear();
+	for (const DrawBatch& batch : renderQueue.batches) {
+		const DrawItem& item = renderQueue.items[batch.first];
+		if (!isInstancedPass(SortKey::pass(item.key))) break;
+		// Every item in the batch has the same key above the depth, so they are all the same mesh and level of detail
+		const HeapMesh& mesh = geometryHeap.mesh(item.node->meshID);
+		const HeapMeshLOD& lod = mesh.lods[item.node->lod];
+		drawCommands.push_back({ lod.indexCount, batch.count, mesh.indexOffset + lod.indexOffset, GLint(mesh.vertexOffset), batch.first });
+		drawInstanceOffsets.push_back(batch.first);
+	}
+
+	// Reserve the worst case including alignment, then write the frame linearly
+	frameRing.beginFrame(sizeof(FrameData) + 3 * frameRing.uniformAlignment
+		+ instanceCount * sizeof(InstanceData) + frameRing.storageAlignment
+		+ drawInstanceOffsets.size() * sizeof(GLuint) + frameRing.storageAlignment
+		+ drawCommands.size() * sizeof(DrawElementsIndirectCommand) + sizeof(GLuint));
+
+	const size_t cameraOffset = frameRing.write(&frame.camera, 1, frameRing.uniformAlignment);
+	const size_t lightsOffset = frameRing.write(&frame.lights, 1, frameRing.uniformAlignment);
+	const size_t ballOffset = frameRing.write(&frame.ball, 1, frameRing.uniformAlignment);
+
+	const size_t instanceOffset = frameRing.allocate(instanceCount * sizeof(InstanceData), frameRing.storageAlignment);
+	InstanceData* instances = static_cast<InstanceData*>(frameRing.pointer(instanceOffset));
+	for (size_t i = 0; i < instanceCount; i++) {
+		const SceneNode* node = renderQueue.items[i].node;
+		instances[i].transform = node->getTransformationMatrix();
+		instances[i].normalMatrix = glm::mat4(node->getNormalMatrix());
+	}
+
+	size_t drawInstanceOffsetsOffset = 0;
+	size_t commandsOffset = 0;
+	if (multiDrawIndirect) {
+		drawInstanceOffsetsOffset = frameRing.write(drawInstanceOffsets.data(), drawInstanceOffsets.size(), frameRing.storageAlignment);
+		commandsOffset = frameRing.write(drawCommands.data(), drawCommands.size(), sizeof(GLuint));
+	}
+	frameRing.flush();
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BINDING, frameRing.id(), cameraOffset, sizeof(CameraData));
+	glBindBufferRange(GL_UNIFORM_BUFFER, LIGHTS_BINDING, frameRing.id(), lightsOffset, sizeof(LightsData));
+	glBindBufferRange(GL_UNIFORM_BUFFER, BALL_BINDING, frameRing.id(), ballOffset, sizeof(BallData));
+	if (instanceCount > 0) {
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, INSTANCES_BINDING, frameRing.id(), instanceOffset, instanceCount * sizeof(InstanceData));
+	}
+	if (multiDrawIndirect && !drawCommands.empty()) {
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_INSTANCE_OFFSETS_BINDING, frameRing.id(),
+			drawInstanceOffsetsOffset, drawInstanceOffsets.size() * sizeof(GLuint));
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, frameRing.id());
+	}
+
+	int currentPass = -1;
+	int currentVariant = -1;
+	int currentMaterial = -1;
+	int currentVAO = -1;
+	GLuint boundTextures[3] = { 0, 0, 0 };
+
+	const std::vector<DrawBatch>& batches = renderQueue.batches;
+	for (size_t b = 0; b < batches.size(); b++) {
+		const DrawBatch& batch = batches[b];
+		const DrawItem& item = renderQueue.items[batch.first];
+		const SceneNode* node = item.node;
+		const RenderPass pass = SortKey::pass(item.key);
+		const uint8_t variant = SortKey::variant(item.key);
+		const uint16_t materialID = SortKey::material(item.key);
+
+		if (pass != currentPass || variant != currentVariant) {
+			if (pass == PASS_GEOMETRY) {
+				assert(geometryShaders[variant] != nullptr && "The shader variant of the draw was not built");
+				geometryShaders[variant]->activate();
+			}
+			else {
+				geometry2DShader->activate();
+			}
+			currentPass = pass;
+			currentVariant = variant;
+		}
+
+		if (materialID != currentMaterial) {
+			const Material& material = renderQueue.material(materialID);
+			const GLuint textures[3] = { textureStreamer.resolve(material.diffuseID),
+				textureStreamer.resolve(material.normalMapID), textureStreamer.resolve(material.roughnessID) };
+			for (GLuint unit = 0; unit < 3; unit++) {
+				if (textures[unit] != boundTextures[unit]) {
+					bindTextureUnit(unit, textures[unit]);
+					boundTextures[unit] = textures[unit];
+				}
+			}
+			currentMaterial = materialID;
+		}
+
+		const int vao = isInstancedPass(pass) ? int(geometryHeap.vertexArray()) : node->vertexArrayObjectID;
+		if (vao != currentVAO) {
+			glBindVertexArray(vao);
+			currentVAO = vao;
+		}
+
+		if (isInstancedPass(pass) && multiDrawIndirect) {
+			// Every following batch with the same variant and material only differs in the mesh and instances
+			const uint64_t state = item.key >> SortKey::MATERIAL_SHIFT;
+			size_t end = b + 1;
+			while (end < drawCommands.size() && renderQueue.items[batches[end].first].key >> SortKey::MATERIAL_SHIFT == state) {
+				end++;
+			}
+			glUniform1i(DRAW_OFFSET_LOCATION, GLint(b));
+			glMultiDrawElementsIndirect(GL_TRIANGLES, geometryHeap.indexType(),
+				(const void*)(commandsOffset + b * sizeof(DrawElementsIndirectCommand)), GLsizei(end - b), 0);
+			b = end - 1;
+		}
+		else if (isInstancedPass(pass)) {
+			const DrawElementsIndirectCommand& command = drawCommands[b];
+			glUniform1i(INSTANCE_OFFSET_LOCATION, command.baseInstance);
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, geometryHeap.indexType(),
+				(const void*)(command.firstIndex * geometryHeap.indexSize()), command.instanceCount, command.baseVertex);
+		}
+		else {
+			glm::mat4 mp = node->getTransformationMatrix() * orth_projection;
+			glUniformMatrix4fv(MP_LOCATION, 1, GL_FALSE, glm::value_ptr(mp));
 			glDrawElements(GL_TRIANGLES, node->VAOIndexCount, GL_UNSIGNED_INT, nullptr);
-			glBindTextureUnit(0, 0);
-			glBindVertexArray(0);
-			break;
-		case POINT_LIGHT: 
-			// Point light data is handled in renderFrame()
-			break;
-		case SPOT_LIGHT:
-			// NOT IMPLEMENTED 
-			std::cerr << "NOT IMPLEMENTED: node type was SPOT_LIGHT" << std::endl;
-			exit(1);
-		default:
-			break;
 		}
 	}
 
-	for (SceneNode* child : node->children) {
-		renderNode(child, renderBitmask);
+	for (GLuint unit = 0; unit < 3; unit++) {
+		if (boundTextures[unit] != 0) bindTextureUnit(unit, 0);
 	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	frameRing.endFrame();
 }
 
 void renderFrame(GLFWwindow* window) {
@@ -604,35 +713,40 @@ void renderFrame(GLFWwindow* window) {
 	glfwGetWindowSize(window, &windowWidth, &windowHeight);
 	glViewport(0, 0, windowWidth, windowHeight);
 
-	{
-		// We update lights every frame as they are usually changing each frame
-		// TODO: currently a hack to unwrap the position from point lights. 
-		//		 do something less hacky instead
-		glm::vec3 positions[POINT_LIGHTS];
-		for (int i = 0; i < POINT_LIGHTS; i++) {
-			// extract world position from transform: make member [3][0], [3][1] and [3][2] to a vec3
-			// these entries happens to be the current translation in the transform and should not be affected
-			// by any other transformation
-			positions[i] = glm::vec3(pointLights.nodes[i]->currentTransformationMatrix[3]);
-		}
-		geometryShader->activate();
-		// TODO: only do update of ambient if the value changes
-		glUniform3fv(geometryVars[AMBIENT], 1, glm::value_ptr(ambient));
-		glUniformMatrix4fv(geometryVars[VIEW_PROJECTION], 1, GL_FALSE, glm::value_ptr(vpMat));
-		glUniform3fv(geometryVars[VIEW_POSITION], 1, glm::value_ptr(glm::vec3(cameraTransform[3])));
-		// TODO: we only need to send the 2 first lights, 
-		//		 consider having some logic to only update moving lights
-		// Send all light positions to the GPU
-		glUniform3fv(geometryVars[PL_POSITION], POINT_LIGHTS, glm::value_ptr(positions[0]));
-		glUniform3fv(geometryVars[PL_COLOR], POINT_LIGHTS, glm::value_ptr(pointLights.color[0]));
-		glUniform3fv(geometryVars[BALL_POSITION], 1, glm::value_ptr(ballNode->position));
-		renderNode(gameRoot, GEOMETRY | GEOMETRY_NORMAL_MAPPED);
-		geometryShader->deactivate();
-	}
-
-	{
-		geometry2DShader->activate();
-		renderNode(uiRoot, GEOMETRY_2D);
-		geometry2DShader->deactivate();
+	textureStreamer.update(TEXTURE_UPLOAD_BUDGET);
+
+	FrameData frame;
+	frame.camera.viewProjection = vpMat;
+	frame.camera.viewPosition = glm::vec4(glm::vec3(cameraTransform[3]), 1);
+	frame.lights.ambient = glm::vec4(ambient, 0);
+	// We update lights every frame as they are usually changing each frame.
+	// Only the first lightCount entries are read by the shaders
+	for (unsigned int i = 0; i < lightCount; i++) {
+		// The translation of the world transform is the light position
+		frame.lights.positions[i] = pointLights.nodes[i]->getTransformationMatrix()[3];
+		frame.lights.colors[i] = glm::vec4(pointLights.color[i], 0);
+		frame.lights.attenuation[i] = pointLights.attenuation[i];
 	}
+	frame.ball.position = ballNode->getPosition();
+	frame.ball.radius = ballMeshRadius;
+
+	// The translation of the inverse view matrix is the eye position
+	lodSettings.viewPosition = glm::vec3(glm::inverse(cameraTransform)[3]);
+	lodSettings.pixelsPerUnit = pers_projection[1][1] * float(windowHeight) / 2.0f;
+
+	StressTime phaseStart = stressNow();
+	cullSceneNodes(vpMat);
+	recordStressPhase(PHASE_CULL, phaseStart);
+
+	phaseStart = stressNow();
+	renderQueue.clear();
+	queueGeometryLayer(LAYER_GEOMETRY, false);
+	queueGeometryLayer(LAYER_NORMAL_MAPPED, true);
+	queueUILayer();
+	renderQueue.sort();
+	recordStressPhase(PHASE_QUEUE, phaseStart);
+
+	phaseStart = stressNow();
+	submitRenderQueue(frame);
+	recordStressPhase(PHASE_SUBMIT, phaseStart);
 }
@@ -7,6 +7,7 @@
 #include <GLFW/glfw3.h>
 
 // Standard headers
+#include <algorithm>
 #include <cstdlib>
 #include <arrrgh.hpp>
 
@@ -74,6 +75,13 @@ int main(int argc, const char* argb[])
     const auto& showHelp = parser.add<bool>("help", "Show this help message.", 'h', arrrgh::Optional, false);
     const auto& enableMusic = parser.add<bool>("enable-music", "Play background music while the game is playing", 'm', arrrgh::Optional, false);
     const auto& enableAutoplay = parser.add<bool>("autoplay", "Let the game play itself automatically. Useful for testing.", 'a', arrrgh::Optional, false);
+    const auto& enableStressTest = parser.add<bool>("stress", "Add a generated scene and print per phase frame timings as JSON.", 's', arrrgh::Optional, false);
+    const auto& stressNodes = parser.add<int>("stress-nodes", "Number of generated nodes, at most 1000000.", 'n', arrrgh::Optional, 100000);
+    const auto& stressDepth = parser.add<int>("stress-depth", "Levels below the root of each generated tree.", 'd', arrrgh::Optional, 4);
+    const auto& stressFanout = parser.add<int>("stress-fanout", "Children of every generated node above the last level.", 'f', arrrgh::Optional, 4);
+    const auto& stressDynamic = parser.add<float>("stress-dynamic", "Fraction of the generated nodes that move every frame.", 'y', arrrgh::Optional, 0.1f);
+    const auto& stressFrames = parser.add<int>("stress-frames", "Number of frames to measure before quitting.", 'r', arrrgh::Optional, 300);
+    const auto& stressReport = parser.add<std::string>("stress-report", "File to write the JSON report to, stdout if not given.", 'o', arrrgh::Optional, "");
 
     // If you want to add more program arguments, define them here,
     // but do not request their value here (they have not been parsed yet at this point).
@@ -98,6 +106,13 @@ int main(int argc, const char* argb[])
     CommandLineOptions options;
     options.enableMusic = enableMusic.value();
     options.enableAutoplay = enableAutoplay.value();
+    options.enableStressTest = enableStressTest.value();
+    options.stressNodes = std::max(stressNodes.value(), 1);
+    options.stressDepth = std::max(stressDepth.value(), 1);
+    options.stressFanout = std::max(stressFanout.value(), 1);
+    options.stressDynamicRatio = stressDynamic.value();
+    options.stressFrames = std::max(stressFrames.value(), 1);
+    options.stressReport = stressReport.value();
 
     // Initialise window using GLFW
     GLFWwindow* window = initialise();
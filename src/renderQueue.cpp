@@ -0,0 +1,78 @@
+#include "renderQueue.hpp"
+#include <cassert>
+
+// LSD radix sort over the 8 bytes of the key. Passes where every key has the same
+// byte are skipped, which is common since most scenes only use a few passes and materials.
+void RenderQueue::sort() {
+	const size_t count = items.size();
+	if (count < 2) {
+		buildBatches();
+		return;
+	}
+	scratch.resize(count);
+
+	DrawItem* source = items.data();
+	DrawItem* destination = scratch.data();
+
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t histogram[256] = { 0 };
+		for (size_t i = 0; i < count; i++) {
+			histogram[(source[i].key >> shift) & 0xFF]++;
+		}
+		if (histogram[(source[0].key >> shift) & 0xFF] == count) {
+			continue;
+		}
+
+		size_t offset = 0;
+		for (size_t& bucket : histogram) {
+			size_t size = bucket;
+			bucket = offset;
+			offset += size;
+		}
+		for (size_t i = 0; i < count; i++) {
+			destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+		}
+		std::swap(source, destination);
+	}
+
+	if (source != items.data()) {
+		items.swap(scratch);
+	}
+
+	buildBatches();
+}
+
+// Everything above the depth bits decides the GL state, so items can share a draw when those bits match
+void RenderQueue::buildBatches() {
+	batches.clear();
+	for (uint32_t i = 0; i < items.size(); i++) {
+		const uint64_t state = items[i].key >> SortKey::VAO_SHIFT;
+		if (!batches.empty() && isInstancedPass(SortKey::pass(items[i].key))) {
+			const DrawBatch& previous = batches.back();
+			if (items[previous.first].key >> SortKey::VAO_SHIFT == state) {
+				batches.back().count++;
+				continue;
+			}
+		}
+		batches.push_back({ i, 1 });
+	}
+}
+
+uint16_t RenderQueue::materialID(const Material& material) {
+	// Texture names are small, 21 bits each is plenty
+	const uint64_t mask = (1u << 21) - 1;
+	const uint64_t lookup = ((material.diffuseID & mask) << 42)
+		| ((material.normalMapID & mask) << 21)
+		| (material.roughnessID & mask);
+
+	auto existing = materialLookup.find(lookup);
+	if (existing != materialLookup.end()) {
+		return existing->second;
+	}
+
+	assert(materials.size() < (1u << SortKey::MATERIAL_BITS) && "Too many materials for the sort key");
+	uint16_t id = materials.size();
+	materials.push_back(material);
+	materialLookup[lookup] = id;
+	return id;
+}
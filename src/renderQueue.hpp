@@ -0,0 +1,144 @@
+#pragma once
+
+#include "sceneGraph.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Passes are drawn in the order listed, they are the most significant part of the sort key
+enum RenderPass {
+	PASS_GEOMETRY		= 0,
+	PASS_GEOMETRY_2D	= 1,
+	MAX_RENDER_PASSES, // !Always last entry!
+};
+
+// Passes whose shader reads its transforms from the instance buffer, consecutive items
+// with the same material and VAO in these passes are drawn with one instanced call
+inline bool isInstancedPass(RenderPass pass) {
+	return pass == PASS_GEOMETRY;
+}
+
+// Blended passes, their items are drawn in the order they are given instead of being grouped by state
+inline bool isOrderedPass(RenderPass pass) {
+	return pass == PASS_GEOMETRY_2D;
+}
+
+// Permutation of the geometry shader. Each variant is its own program, built with the defines of
+// the variant, so the shader does not branch on uniforms. Packed as normal mapped (1 bit) | lights (3 bits)
+namespace ShaderVariant {
+	const unsigned int NORMAL_MAPPED = 1;
+	const int LIGHT_COUNT_SHIFT = 1;
+	const unsigned int MAX_LIGHT_COUNT = 7;
+	const unsigned int MAX_VARIANTS = 16;
+
+	inline uint8_t make(bool normalMapped, unsigned int lightCount) {
+		assert(lightCount <= MAX_LIGHT_COUNT && "Too many lights for the shader variant");
+		return uint8_t((normalMapped ? NORMAL_MAPPED : 0) | (lightCount << LIGHT_COUNT_SHIFT));
+	}
+
+	inline bool normalMapped(uint8_t variant) { return (variant & NORMAL_MAPPED) != 0; }
+	inline unsigned int lightCount(uint8_t variant) { return variant >> LIGHT_COUNT_SHIFT; }
+}
+
+// The textures a draw binds
+struct Material {
+	GLuint diffuseID;
+	GLuint normalMapID;
+	GLuint roughnessID;
+};
+
+// 64 bit sort key, from most to least significant:
+// pass (4 bits) | shader variant (4 bits) | material (16 bits) | VAO (20 bits) | depth (20 bits)
+// Sorting by the key groups draws that share state, and draws front to back within a group.
+// The variant picks the program, so it sorts right below the pass to switch programs as rarely as possible.
+// Ordered passes use makeOrdered instead, which moves the depth bits right below the pass and uses them for the order:
+// pass (4 bits) | order (20 bits) | shader variant (4 bits) | material (16 bits) | VAO (20 bits)
+namespace SortKey {
+	const int DEPTH_BITS = 20;
+	const int VAO_BITS = 20;
+	const int MATERIAL_BITS = 16;
+	const int VARIANT_BITS = 4;
+	const int PASS_BITS = 4;
+
+	const int VAO_SHIFT = DEPTH_BITS;
+	const int MATERIAL_SHIFT = VAO_SHIFT + VAO_BITS;
+	const int VARIANT_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+	const int PASS_SHIFT = VARIANT_SHIFT + VARIANT_BITS;
+
+	const int ORDER_BITS = DEPTH_BITS;
+	const int ORDER_SHIFT = PASS_SHIFT - ORDER_BITS;
+	const uint64_t BELOW_PASS = (uint64_t(1) << PASS_SHIFT) - 1;
+
+	inline uint64_t make(RenderPass pass, uint8_t variant, uint16_t material, GLuint vao, uint32_t depth) {
+		return (uint64_t(pass) << PASS_SHIFT)
+			| (uint64_t(variant & ((1u << VARIANT_BITS) - 1)) << VARIANT_SHIFT)
+			| (uint64_t(material) << MATERIAL_SHIFT)
+			| (uint64_t(vao & ((1u << VAO_BITS) - 1)) << VAO_SHIFT)
+			| uint64_t(depth & ((1u << DEPTH_BITS) - 1));
+	}
+
+	inline RenderPass pass(uint64_t key) { return RenderPass(key >> PASS_SHIFT); }
+
+	inline uint64_t makeOrdered(RenderPass pass, uint32_t order, uint8_t variant, uint16_t material, GLuint vao) {
+		assert(isOrderedPass(pass) && "Only ordered passes sort by their order");
+		const uint64_t key = make(pass, variant, material, vao, 0);
+		return (key & ~BELOW_PASS)
+			| (uint64_t(order & ((1u << ORDER_BITS) - 1)) << ORDER_SHIFT)
+			| ((key & BELOW_PASS) >> DEPTH_BITS);
+	}
+
+	// Any key in the layout of make, the order of an ordered pass ends up in the depth bits
+	inline uint64_t unpack(uint64_t key) {
+		if (!isOrderedPass(pass(key))) return key;
+		return (key & ~BELOW_PASS)
+			| ((key & ((uint64_t(1) << ORDER_SHIFT) - 1)) << DEPTH_BITS)
+			| ((key >> ORDER_SHIFT) & ((1u << ORDER_BITS) - 1));
+	}
+
+	inline uint8_t variant(uint64_t key) { return uint8_t((unpack(key) >> VARIANT_SHIFT) & ((1u << VARIANT_BITS) - 1)); }
+	inline uint16_t material(uint64_t key) { return uint16_t(unpack(key) >> MATERIAL_SHIFT); }
+
+	// Quantize a depth in [0, 1] to the depth bits
+	inline uint32_t depth(float depth01) {
+		if (depth01 < 0) depth01 = 0;
+		if (depth01 > 1) depth01 = 1;
+		return uint32_t(depth01 * float((1u << DEPTH_BITS) - 1));
+	}
+}
+
+struct DrawItem {
+	uint64_t key;
+	const SceneNode* node;
+};
+
+// Consecutive items [first, first + count) drawn with a single call
+struct DrawBatch {
+	uint32_t first;
+	uint32_t count;
+};
+
+struct RenderQueue {
+	std::vector<DrawItem> items;
+	// Built by sort()
+	std::vector<DrawBatch> batches;
+
+	void clear() { items.clear(); batches.clear(); }
+	void push(uint64_t key, const SceneNode* node) { items.push_back({ key, node }); }
+
+	// Radix sort the items by key and group them into batches.
+	// The sort is stable, so items with equal keys keep their queue order
+	void sort();
+
+	// Materials are interned so the key only needs a small id
+	uint16_t materialID(const Material& material);
+	const Material& material(uint16_t id) const { return materials[id]; }
+
+private:
+	void buildBatches();
+
+	std::vector<DrawItem> scratch;
+	std::vector<Material> materials;
+	std::unordered_map<uint64_t, uint16_t> materialLookup;
+};
@@ -0,0 +1,551 @@
+#include "sceneFile.hpp"
+#include "utilities/meshRegistry.hpp"
+#include "utilities/glutils.h"
+#include "utilities/imageLoader.hpp"
+#include "utilities/shapes.h"
+#include "utilities/textureStreamer.hpp"
+#include "utilities/threadPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+// Everything the cooker collects before the arrays are written out
+struct SceneCooker {
+	std::vector<SceneFileNode> nodes;
+	std::vector<SceneFileMesh> meshes;
+	std::vector<SceneFileMaterial> materials;
+	std::vector<SceneFileTexture> textures;
+	std::vector<SceneFileLight> lights;
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoordinates;
+	std::vector<unsigned int> indices;
+	std::vector<char> strings;
+
+	// Meshes in declaration order, they are simplified together once the whole file is read
+	std::vector<std::pair<std::string, Mesh>> pendingMeshes;
+
+	// Name -> index into the array of that kind
+	std::map<std::string, int> nodeNames;
+	std::map<std::string, int> meshNames;
+	std::map<std::string, int> materialNames;
+	std::map<std::string, int> textureNames;
+
+	uint32_t addString(const std::string& value) {
+		const uint32_t offset = strings.size();
+		strings.insert(strings.end(), value.begin(), value.end());
+		strings.push_back('\0');
+		return offset;
+	}
+
+	void addMesh(const std::string& name, const Mesh& mesh, const std::vector<MeshLOD>& lods) {
+		SceneFileMesh entry = {};
+		entry.name = addString(name);
+		entry.vertexOffset = vertices.size();
+		entry.vertexCount = mesh.vertices.size();
+		entry.indexOffset = indices.size();
+		entry.lodCount = lods.size();
+		for (size_t i = 0; i < lods.size(); i++) {
+			entry.lods[i] = { uint32_t(indices.size()) - entry.indexOffset, uint32_t(lods[i].indices.size()), lods[i].error };
+			indices.insert(indices.end(), lods[i].indices.begin(), lods[i].indices.end());
+		}
+		entry.indexCount = indices.size() - entry.indexOffset;
+		entry.hasTextureCoordinates = mesh.textureCoordinates.size() == mesh.vertices.size();
+
+		vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+		normals.insert(normals.end(), mesh.normals.begin(), mesh.normals.end());
+		normals.resize(vertices.size(), glm::vec3(0));
+		if (entry.hasTextureCoordinates) {
+			textureCoordinates.resize(entry.vertexOffset, glm::vec2(0));
+			textureCoordinates.insert(textureCoordinates.end(), mesh.textureCoordinates.begin(), mesh.textureCoordinates.end());
+		}
+		meshes.push_back(entry);
+	}
+};
+
+const std::map<std::string, SceneNodeType> NODE_TYPE_NAMES = {
+	{ "empty", EMPTY },
+	{ "geometry", GEOMETRY },
+	{ "geometry_normal_mapped", GEOMETRY_NORMAL_MAPPED },
+	{ "point_light", POINT_LIGHT },
+};
+
+// Reports the first error of a line, later reads fail silently so statements don't need to check every token
+class LineReader {
+public:
+	LineReader(const std::string& path, int lineNumber, const std::string& line)
+		: path(path), lineNumber(lineNumber), tokens(line) {}
+
+	bool failed() const { return hasFailed; }
+	bool atEnd() {
+		tokens >> std::ws;
+		return tokens.eof();
+	}
+
+	void error(const std::string& message) {
+		if (!hasFailed) {
+			fprintf(stderr, "%s:%i: %s\n", path.c_str(), lineNumber, message.c_str());
+		}
+		hasFailed = true;
+	}
+
+	std::string word(const char* what) {
+		std::string value;
+		if (!(tokens >> value)) error(std::string("expected ") + what);
+		return value;
+	}
+
+	float number() {
+		float value = 0;
+		if (!(tokens >> value)) error("expected a number");
+		return value;
+	}
+
+	glm::vec3 vec3() {
+		float x = number();
+		float y = number();
+		float z = number();
+		return glm::vec3(x, y, z);
+	}
+
+	// Index of a previously declared name
+	int reference(const std::map<std::string, int>& names, const char* what) {
+		const std::string name = word(what);
+		auto found = names.find(name);
+		if (found == names.end()) {
+			error(std::string("unknown ") + what + " '" + name + "'");
+			return -1;
+		}
+		return found->second;
+	}
+
+	// Names have to be unique within their kind
+	std::string declaration(const std::map<std::string, int>& names, const char* what) {
+		const std::string name = word("a name");
+		if (names.count(name) > 0) error(std::string("duplicate ") + what + " '" + name + "'");
+		return name;
+	}
+
+private:
+	const std::string& path;
+	int lineNumber;
+	std::istringstream tokens;
+	bool hasFailed = false;
+};
+
+void cookTexture(SceneCooker& cooker, LineReader& line) {
+	const std::string name = line.declaration(cooker.textureNames, "texture");
+	SceneFileTexture texture;
+	texture.path = cooker.addString(line.word("a path"));
+	texture.format = TEXTURE_FILE_RGBA8;
+	while (!line.failed() && !line.atEnd()) {
+		const std::string option = line.word("an option");
+		uint32_t format = 0;
+		while (format < MAX_TEXTURE_FILE_FORMATS && option != textureFileFormatName(TextureFileFormat(format))) format++;
+		if (format < MAX_TEXTURE_FILE_FORMATS) texture.format = format;
+		else line.error("unknown texture option '" + option + "'");
+	}
+	cooker.textureNames[name] = cooker.textures.size();
+	cooker.textures.push_back(texture);
+}
+
+// The shapes are generated while cooking, loading only copies the vertices into the geometry heap
+void cookMesh(SceneCooker& cooker, LineReader& line) {
+	const std::string name = line.declaration(cooker.meshNames, "mesh");
+	const std::string shape = line.word("a shape");
+	Mesh mesh;
+	if (shape == "cube") {
+		glm::vec3 size = line.vec3();
+		glm::vec2 textureScale(1);
+		bool tiling = false;
+		bool inverted = false;
+		while (!line.failed() && !line.atEnd()) {
+			const std::string option = line.word("an option");
+			if (option == "uv") {
+				textureScale.x = line.number();
+				textureScale.y = line.number();
+			}
+			else if (option == "tiling") tiling = true;
+			else if (option == "inverted") inverted = true;
+			else line.error("unknown cube option '" + option + "'");
+		}
+		if (!line.failed()) mesh = cube(size, textureScale, tiling, inverted);
+	}
+	else if (shape == "sphere") {
+		float radius = line.number();
+		int slices = int(line.number());
+		int layers = int(line.number());
+		if (!line.failed()) mesh = generateSphere(radius, slices, layers);
+	}
+	else {
+		line.error("unknown shape '" + shape + "'");
+	}
+	if (line.failed()) return;
+	cooker.meshNames[name] = cooker.pendingMeshes.size();
+	cooker.pendingMeshes.push_back({ name, mesh });
+}
+
+void cookMaterial(SceneCooker& cooker, LineReader& line) {
+	const std::string name = line.declaration(cooker.materialNames, "material");
+	SceneFileMaterial material = { -1, -1, -1 };
+	while (!line.failed() && !line.atEnd()) {
+		const std::string slot = line.word("a texture slot");
+		if (slot == "diffuse") material.diffuse = line.reference(cooker.textureNames, "texture");
+		else if (slot == "normal") material.normalMap = line.reference(cooker.textureNames, "texture");
+		else if (slot == "roughness") material.roughness = line.reference(cooker.textureNames, "texture");
+		else line.error("unknown texture slot '" + slot + "'");
+	}
+	cooker.materialNames[name] = cooker.materials.size();
+	cooker.materials.push_back(material);
+}
+
+void cookNode(SceneCooker& cooker, LineReader& line) {
+	const std::string name = line.declaration(cooker.nodeNames, "node");
+	const std::string typeName = line.word("a node type");
+	auto type = NODE_TYPE_NAMES.find(typeName);
+	if (type == NODE_TYPE_NAMES.end()) {
+		line.error("unknown node type '" + typeName + "'");
+		return;
+	}
+
+	SceneFileNode node;
+	node.name = 0;
+	node.parent = -1;
+	node.type = type->second;
+	node.mesh = -1;
+	node.material = -1;
+	node.light = -1;
+	node.position = glm::vec3(0);
+	node.rotation = glm::vec3(0);
+	node.scale = glm::vec3(1);
+	node.referencePoint = glm::vec3(0);
+	SceneFileLight light = { glm::vec3(1), 1, 0, 0 };
+
+	while (!line.failed() && !line.atEnd()) {
+		const std::string property = line.word("a property");
+		if (property == "parent") node.parent = line.reference(cooker.nodeNames, "node");
+		else if (property == "mesh") node.mesh = line.reference(cooker.meshNames, "mesh");
+		else if (property == "material") node.material = line.reference(cooker.materialNames, "material");
+		else if (property == "position") node.position = line.vec3();
+		else if (property == "rotation") node.rotation = line.vec3();
+		else if (property == "scale") node.scale = line.vec3();
+		else if (property == "reference") node.referencePoint = line.vec3();
+		else if (property == "color") light.color = line.vec3();
+		else if (property == "attenuation") {
+			light.constant = line.number();
+			light.linear = line.number();
+			light.quadratic = line.number();
+		}
+		else line.error("unknown node property '" + property + "'");
+	}
+
+	const bool isGeometry = (node.type & (GEOMETRY | GEOMETRY_NORMAL_MAPPED)) > 0;
+	if (isGeometry && node.mesh == -1) line.error("geometry node without a mesh");
+	if (!isGeometry && node.mesh != -1) line.error("only geometry nodes can have a mesh");
+	if (line.failed()) return;
+
+	if (node.type == POINT_LIGHT) {
+		node.light = cooker.lights.size();
+		cooker.lights.push_back(light);
+	}
+	node.name = cooker.addString(name);
+	cooker.nodeNames[name] = cooker.nodes.size();
+	cooker.nodes.push_back(node);
+}
+
+template <class T> SceneFileSection writeSection(std::ofstream& out, const std::vector<T>& data) {
+	// Every element type is made of 4 byte fields, so 4 byte alignment keeps them aligned in the mapping
+	while (out.tellp() % 4 != 0) out.put('\0');
+	SceneFileSection section = { uint32_t(out.tellp()), uint32_t(data.size()) };
+	out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T));
+	return section;
+}
+
+bool cookSceneFile(const std::string& textPath, const std::string& binaryPath) {
+	std::ifstream in(textPath);
+	if (!in) {
+		fprintf(stderr, "Could not open scene file %s\n", textPath.c_str());
+		return false;
+	}
+
+	SceneCooker cooker;
+	// Offset 0 is the empty string
+	cooker.addString("");
+
+	bool failed = false;
+	std::string text;
+	for (int lineNumber = 1; std::getline(in, text); lineNumber++) {
+		text = text.substr(0, text.find('#'));
+		LineReader line(textPath, lineNumber, text);
+		if (line.atEnd()) continue;
+
+		const std::string statement = line.word("a statement");
+		if (statement == "texture") cookTexture(cooker, line);
+		else if (statement == "mesh") cookMesh(cooker, line);
+		else if (statement == "material") cookMaterial(cooker, line);
+		else if (statement == "node") cookNode(cooker, line);
+		else line.error("unknown statement '" + statement + "'");
+		failed |= line.failed();
+	}
+	if (failed) {
+		return false;
+	}
+
+	std::vector<std::vector<MeshLOD>> lods(cooker.pendingMeshes.size());
+	ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+	pool.parallelFor(cooker.pendingMeshes.size(), [&](unsigned int i) {
+		Mesh& mesh = cooker.pendingMeshes[i].second;
+		weldMesh(mesh);
+		lods[i] = generateLODChain(mesh);
+	});
+	for (size_t i = 0; i < cooker.pendingMeshes.size(); i++) {
+		cooker.addMesh(cooker.pendingMeshes[i].first, cooker.pendingMeshes[i].second, lods[i]);
+	}
+
+	std::vector<SceneFileName> names;
+	for (const auto& name : cooker.nodeNames) {
+		names.push_back({ cooker.nodes[name.second].name, uint32_t(name.second) });
+	}
+	// std::map iterates in name order, which is the order find() searches in
+	if (!cooker.textureCoordinates.empty()) {
+		cooker.textureCoordinates.resize(cooker.vertices.size(), glm::vec2(0));
+	}
+
+	std::ofstream out(binaryPath, std::ios::binary);
+	if (!out) {
+		fprintf(stderr, "Could not write scene file %s\n", binaryPath.c_str());
+		return false;
+	}
+	SceneFileHeader header = {};
+	reserveHeader(out, sizeof(header));
+	header.magic = SCENE_FILE_MAGIC;
+	header.version = SCENE_FILE_VERSION;
+	header.nodes = writeSection(out, cooker.nodes);
+	header.names = writeSection(out, names);
+	header.meshes = writeSection(out, cooker.meshes);
+	header.materials = writeSection(out, cooker.materials);
+	header.textures = writeSection(out, cooker.textures);
+	header.lights = writeSection(out, cooker.lights);
+	header.vertices = writeSection(out, cooker.vertices);
+	header.normals = writeSection(out, cooker.normals);
+	header.textureCoordinates = writeSection(out, cooker.textureCoordinates);
+	header.indices = writeSection(out, cooker.indices);
+	header.strings = writeSection(out, cooker.strings);
+
+	return writeHeader(out, &header, sizeof(header));
+}
+
+// Typed pointer to the first element of a section
+template <class T> const T* sectionData(const MappedFile& file, const SceneFileSection& section) {
+	return reinterpret_cast<const T*>(file.data() + section.offset);
+}
+
+template <class T> bool sectionFits(const MappedFile& file, const SceneFileSection& section) {
+	return section.offset % 4 == 0 && section.offset <= file.size()
+		&& section.count <= (file.size() - section.offset) / sizeof(T);
+}
+
+const SceneFileHeader* validHeader(const MappedFile& file) {
+	if (file.size() < sizeof(SceneFileHeader)) return nullptr;
+	const SceneFileHeader* header = reinterpret_cast<const SceneFileHeader*>(file.data());
+	if (header->magic != SCENE_FILE_MAGIC || header->version != SCENE_FILE_VERSION) return nullptr;
+
+	const bool fits = sectionFits<SceneFileNode>(file, header->nodes)
+		&& sectionFits<SceneFileName>(file, header->names)
+		&& sectionFits<SceneFileMesh>(file, header->meshes)
+		&& sectionFits<SceneFileMaterial>(file, header->materials)
+		&& sectionFits<SceneFileTexture>(file, header->textures)
+		&& sectionFits<SceneFileLight>(file, header->lights)
+		&& sectionFits<glm::vec3>(file, header->vertices)
+		&& sectionFits<glm::vec3>(file, header->normals)
+		&& sectionFits<glm::vec2>(file, header->textureCoordinates)
+		&& sectionFits<unsigned int>(file, header->indices)
+		&& sectionFits<char>(file, header->strings)
+		&& header->strings.count > 0
+		&& file.data()[header->strings.offset + header->strings.count - 1] == '\0';
+	return fits ? header : nullptr;
+}
+
+// An index stored in a record is -1 or inside the section it points into
+bool validIndex(int32_t index, const SceneFileSection& section) {
+	return index == -1 || (index >= 0 && uint32_t(index) < section.count);
+}
+
+bool validRange(uint64_t offset, uint64_t count, const SceneFileSection& section) {
+	return offset <= section.count && count <= section.count - offset;
+}
+
+// validHeader only checks that the sections fit in the file. Every index and range in the records is
+// checked here, so a stale or corrupt file is rejected and cooked again instead of read out of bounds
+bool validRecords(const MappedFile& file, const SceneFileHeader& header) {
+	const SceneFileNode* nodes = sectionData<SceneFileNode>(file, header.nodes);
+	for (uint32_t i = 0; i < header.nodes.count; i++) {
+		const SceneFileNode& node = nodes[i];
+		// Exactly one SceneNodeType bit
+		const bool validType = node.type != 0 && node.type <= SPOT_LIGHT && (node.type & (node.type - 1)) == 0;
+		// The cooker only writes parents before their children
+		if (node.name >= header.strings.count || !validType || node.parent < -1 || node.parent >= int32_t(i)
+			|| !validIndex(node.mesh, header.meshes) || !validIndex(node.material, header.materials)
+			|| !validIndex(node.light, header.lights)) {
+			return false;
+		}
+	}
+
+	const SceneFileName* names = sectionData<SceneFileName>(file, header.names);
+	for (uint32_t i = 0; i < header.names.count; i++) {
+		if (names[i].name >= header.strings.count || names[i].node >= header.nodes.count) return false;
+	}
+
+	const SceneFileMaterial* materials = sectionData<SceneFileMaterial>(file, header.materials);
+	for (uint32_t i = 0; i < header.materials.count; i++) {
+		if (!validIndex(materials[i].diffuse, header.textures) || !validIndex(materials[i].normalMap, header.textures)
+			|| !validIndex(materials[i].roughness, header.textures)) {
+			return false;
+		}
+	}
+
+	const SceneFileTexture* textures = sectionData<SceneFileTexture>(file, header.textures);
+	for (uint32_t i = 0; i < header.textures.count; i++) {
+		if (textures[i].path >= header.strings.count || textures[i].format >= MAX_TEXTURE_FILE_FORMATS) return false;
+	}
+
+	const SceneFileMesh* meshes = sectionData<SceneFileMesh>(file, header.meshes);
+	for (uint32_t i = 0; i < header.meshes.count; i++) {
+		const SceneFileMesh& mesh = meshes[i];
+		if (mesh.name >= header.strings.count || !validRange(mesh.vertexOffset, mesh.vertexCount, header.vertices)
+			|| !validRange(mesh.vertexOffset, mesh.vertexCount, header.normals)
+			|| (mesh.hasTextureCoordinates && !validRange(mesh.vertexOffset, mesh.vertexCount, header.textureCoordinates))
+			|| !validRange(mesh.indexOffset, mesh.indexCount, header.indices)) {
+			return false;
+		}
+		// The first level is the full mesh, the registry and the draw code expect it to exist
+		if (mesh.lodCount == 0 || mesh.lodCount > MAX_MESH_LODS || mesh.lods[0].indexCount == 0) return false;
+		const SceneFileSection meshIndices = { 0, mesh.indexCount };
+		for (uint32_t lod = 0; lod < mesh.lodCount; lod++) {
+			if (!validRange(mesh.lods[lod].indexOffset, mesh.lods[lod].indexCount, meshIndices)) return false;
+		}
+	}
+	return true;
+}
+
+bool loadSceneFile(const std::string& binaryPath, SceneNodeHandle parent, MeshRegistry& registry, TextureStreamer& streamer, LoadedScene& scene) {
+	MappedFile file;
+	if (!file.open(binaryPath)) {
+		return false;
+	}
+	const SceneFileHeader* header = validHeader(file);
+	if (header == nullptr || !validRecords(file, *header)) {
+		fprintf(stderr, "%s is not a valid scene file\n", binaryPath.c_str());
+		return false;
+	}
+	const char* strings = sectionData<char>(file, header->strings);
+
+	const SceneFileMaterial* materials = sectionData<SceneFileMaterial>(file, header->materials);
+	const SceneFileLight* lights = sectionData<SceneFileLight>(file, header->lights);
+	const SceneFileNode* nodes = sectionData<SceneFileNode>(file, header->nodes);
+
+	// Textures are cooked and uploaded in the background, normal maps show a flat normal until they arrive
+	std::vector<TexturePlaceholder> placeholders(header->textures.count, PLACEHOLDER_GREY);
+	for (uint32_t i = 0; i < header->materials.count; i++) {
+		if (materials[i].normalMap != -1) placeholders[materials[i].normalMap] = PLACEHOLDER_FLAT_NORMAL;
+	}
+	const SceneFileTexture* textures = sectionData<SceneFileTexture>(file, header->textures);
+	scene.textures.clear();
+	for (uint32_t i = 0; i < header->textures.count; i++) {
+		scene.textures.push_back(streamer.request(strings + textures[i].path, TextureFileFormat(textures[i].format), placeholders[i]));
+	}
+
+	scene.meshes.clear();
+	const SceneFileMesh* meshes = sectionData<SceneFileMesh>(file, header->meshes);
+	const glm::vec3* vertices = sectionData<glm::vec3>(file, header->vertices);
+	const glm::vec3* normals = sectionData<glm::vec3>(file, header->normals);
+	const glm::vec2* textureCoordinates = sectionData<glm::vec2>(file, header->textureCoordinates);
+	const unsigned int* indices = sectionData<unsigned int>(file, header->indices);
+	for (uint32_t i = 0; i < header->meshes.count; i++) {
+		const SceneFileMesh& entry = meshes[i];
+		Mesh mesh;
+		mesh.vertices.assign(vertices + entry.vertexOffset, vertices + entry.vertexOffset + entry.vertexCount);
+		mesh.normals.assign(normals + entry.vertexOffset, normals + entry.vertexOffset + entry.vertexCount);
+		if (entry.hasTextureCoordinates) {
+			mesh.textureCoordinates.assign(textureCoordinates + entry.vertexOffset, textureCoordinates + entry.vertexOffset + entry.vertexCount);
+		}
+		std::vector<MeshLOD> lods(entry.lodCount);
+		for (size_t lod = 0; lod < lods.size(); lod++) {
+			const unsigned int* first = indices + entry.indexOffset + entry.lods[lod].indexOffset;
+			lods[lod].indices.assign(first, first + entry.lods[lod].indexCount);
+			lods[lod].error = entry.lods[lod].error;
+		}
+		mesh.indices = lods[0].indices;
+		scene.meshes.push_back(registry.acquire(mesh, lods));
+	}
+
+	auto texture = [&](int32_t index) { return index == -1 ? 0 : scene.textures[index]; };
+
+	scene.root = createSceneNode(EMPTY, parent);
+	scene.nodes.clear();
+	scene.nodes.reserve(header->nodes.count);
+	scene.lights.clear();
+	for (uint32_t i = 0; i < header->nodes.count; i++) {
+		const SceneFileNode& entry = nodes[i];
+		SceneNodeHandle handle = createSceneNode(SceneNodeType(entry.type), entry.parent == -1 ? scene.root : scene.nodes[entry.parent]);
+		SceneNode* node = handle.get();
+		node->setPosition(entry.position);
+		node->setRotation(entry.rotation);
+		node->setScale(entry.scale);
+		node->setReferencePoint(entry.referencePoint);
+
+		if (entry.mesh != -1) {
+			node->meshID = scene.meshes[entry.mesh];
+			node->setLocalBounds(registry.heap().mesh(node->meshID).bounds);
+		}
+		if (entry.material != -1) {
+			const SceneFileMaterial& material = materials[entry.material];
+			node->diffuseID = texture(material.diffuse);
+			node->normalMapID = texture(material.normalMap);
+			node->roughnessID = texture(material.roughness);
+		}
+		if (entry.light != -1) {
+			const SceneFileLight& light = lights[entry.light];
+			scene.lights.push_back({ handle, light.color, light.constant, light.linear, light.quadratic });
+		}
+		scene.nodes.push_back(handle);
+	}
+
+	scene.file = std::move(file);
+	return true;
+}
+
+SceneNodeHandle LoadedScene::find(const std::string& name) const {
+	if (!file.isOpen()) {
+		return SceneNodeHandle();
+	}
+	const SceneFileHeader* header = reinterpret_cast<const SceneFileHeader*>(file.data());
+	const SceneFileName* names = sectionData<SceneFileName>(file, header->names);
+	const char* strings = sectionData<char>(file, header->strings);
+
+	const SceneFileName* end = names + header->names.count;
+	const SceneFileName* found = std::lower_bound(names, end, name, [&](const SceneFileName& entry, const std::string& value) {
+		return std::strcmp(strings + entry.name, value.c_str()) < 0;
+	});
+	if (found == end || name != strings + found->name) {
+		return SceneNodeHandle();
+	}
+	return nodes[found->node];
+}
+
+bool loadScene(const std::string& textPath, SceneNodeHandle parent, MeshRegistry& registry, TextureStreamer& streamer, LoadedScene& scene) {
+	const std::string binaryPath = textPath + "b";
+	const time_t cooked = modificationTime(binaryPath);
+	if (cooked == 0 || cooked < modificationTime(textPath)) {
+		if (!cookSceneFile(textPath, binaryPath)) return false;
+	}
+	if (loadSceneFile(binaryPath, parent, registry, streamer, scene)) {
+		return true;
+	}
+	// Files cooked by an older version are rejected by the header check, cook them again
+	return cookSceneFile(textPath, binaryPath) && loadSceneFile(binaryPath, parent, registry, streamer, scene);
+}
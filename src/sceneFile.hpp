@@ -0,0 +1,153 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sceneGraph.hpp"
+#include "utilities/mappedFile.hpp"
+#include "utilities/meshSimplify.hpp"
+#include "utilities/textureFile.hpp"
+
+class MeshRegistry;
+class TextureStreamer;
+
+// Scenes are written as text (see res/scenes/) and cooked into a binary file next to it.
+// The binary file is a header followed by flat arrays. It is memory mapped and nodes are
+// created straight from the mapped arrays, loading never parses anything.
+//
+// Text format, one statement per line and '#' starts a comment:
+//   texture <name> <path> [rgba|r8|bc1|bc4|bc5|bc7]
+//   mesh <name> cube <x> <y> <z> [uv <u> <v>] [tiling] [inverted]
+//   mesh <name> sphere <radius> <slices> <layers>
+//   material <name> [diffuse <texture>] [normal <texture>] [roughness <texture>]
+//   node <name> <empty|geometry|geometry_normal_mapped|point_light> [parent <node>] [mesh <mesh>] [material <material>]
+//        [position <x> <y> <z>] [rotation <x> <y> <z>] [scale <x> <y> <z>] [reference <x> <y> <z>]
+//        [color <r> <g> <b>] [attenuation <constant> <linear> <quadratic>]
+// Nodes have to be declared after their parent, so the file order is a valid creation order.
+
+const uint32_t SCENE_FILE_MAGIC = 0x43534247; // "GBSC"
+const uint32_t SCENE_FILE_VERSION = 2;
+
+// Byte offset from the start of the file and number of elements
+struct SceneFileSection {
+	uint32_t offset;
+	uint32_t count;
+};
+
+struct SceneFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	SceneFileSection nodes;
+	// Sorted by name so nodes can be found with a binary search
+	SceneFileSection names;
+	SceneFileSection meshes;
+	SceneFileSection materials;
+	SceneFileSection textures;
+	SceneFileSection lights;
+	// Vertex data of every mesh, back to back
+	SceneFileSection vertices;
+	SceneFileSection normals;
+	SceneFileSection textureCoordinates;
+	SceneFileSection indices;
+	// Zero terminated strings, referenced by their offset into this section
+	SceneFileSection strings;
+};
+
+struct SceneFileNode {
+	uint32_t name;
+	// Index of an earlier node, -1 for nodes attached to the root of the scene
+	int32_t parent;
+	uint32_t type;
+	// Indices into the mesh, material and light arrays, -1 when the node has none
+	int32_t mesh;
+	int32_t material;
+	int32_t light;
+	glm::vec3 position;
+	glm::vec3 rotation;
+	glm::vec3 scale;
+	glm::vec3 referencePoint;
+};
+
+struct SceneFileName {
+	uint32_t name;
+	uint32_t node;
+};
+
+// indexOffset is relative to the mesh's first index
+struct SceneFileLOD {
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;
+};
+
+// Offsets and counts are in elements of the vertex and index sections, the index range holds every level of detail.
+// Texture coordinates are either stored for every vertex or not at all
+struct SceneFileMesh {
+	uint32_t name;
+	uint32_t vertexOffset;
+	uint32_t vertexCount;
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	uint32_t hasTextureCoordinates;
+	uint32_t lodCount;
+	SceneFileLOD lods[MAX_MESH_LODS];
+};
+
+// Indices into the texture array, -1 when unused
+struct SceneFileMaterial {
+	int32_t diffuse;
+	int32_t normalMap;
+	int32_t roughness;
+};
+
+struct SceneFileTexture {
+	uint32_t path;
+	// TextureFileFormat the PNG is cooked into
+	uint32_t format;
+};
+
+struct SceneFileLight {
+	glm::vec3 color;
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+struct SceneLight {
+	SceneNodeHandle node;
+	glm::vec3 color;
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+// The nodes and GPU resources created from one scene file
+struct LoadedScene {
+	// Every node of the file is below this node, destroying it removes the whole scene
+	SceneNodeHandle root;
+	// In file order
+	std::vector<SceneNodeHandle> nodes;
+	// Geometry heap ids, each holding a reference in the registry the scene was loaded with, and texture names, in file order
+	std::vector<int> meshes;
+	std::vector<GLuint> textures;
+	// In file order
+	std::vector<SceneLight> lights;
+
+	// Null handle when there is no node with that name
+	SceneNodeHandle find(const std::string& name) const;
+
+	// The mapping stays open for the names
+	MappedFile file;
+};
+
+// Compile a text scene into a binary scene, errors are printed with the line they were found on.
+// Meshes are welded and get their levels of detail here, one mesh per thread
+bool cookSceneFile(const std::string& textPath, const std::string& binaryPath);
+// Map a binary scene and create its nodes below `parent`. Returns false if the file is missing or invalid.
+// The textures are requested from `streamer` and show their placeholder until it has uploaded them
+bool loadSceneFile(const std::string& binaryPath, SceneNodeHandle parent, MeshRegistry& registry, TextureStreamer& streamer, LoadedScene& scene);
+// Load the binary scene cooked from `textPath`, cooking it first if it is missing or older than the text
+bool loadScene(const std::string& textPath, SceneNodeHandle parent, MeshRegistry& registry, TextureStreamer& streamer, LoadedScene& scene);
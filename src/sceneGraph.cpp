@@ -1,25 +1,636 @@
 #include "sceneGraph.hpp"
 #include <iostream>
+#include <algorithm>
+#include "utilities/transformKernel.hpp"
+#include "utilities/threadPool.hpp"
 
-SceneNode* createSceneNode(SceneNodeType nodeType) {
-	return new SceneNode(nodeType);
+SceneTransforms sceneTransforms;
+SceneNodePool sceneNodePool;
+DynamicAABBTree sceneBVH;
+CullingStats cullingStats;
+std::vector<SceneNode*> renderLayers[MAX_RENDER_LAYERS];
+
+// Scratch lists of entries handed to the batched transform kernels, one per update task.
+// Kept between frames to avoid allocations
+struct UpdateScratch {
+	std::vector<unsigned int> dirtyLocals;
+	std::vector<unsigned int> dirtyNormals;
+	std::vector<unsigned int> dirtyUniformNormals;
+	// Entries whose world bounds changed, moved in the BVH after the update
+	std::vector<unsigned int> dirtyBounds;
+	unsigned int recomputedNodes;
+};
+
+// Work split used by the parallel update, rebuilt with the order.
+// Every range is one or more complete subtrees whose ancestors are all in serialNodes.
+struct UpdatePartition {
+	std::vector<unsigned int> serialNodes;
+	std::vector<std::pair<unsigned int, unsigned int>> ranges;
+	std::vector<UpdateScratch> scratch;
+	UpdateScratch serialScratch;
+	bool dirty = true;
+} updatePartition;
+
+std::unique_ptr<ThreadPool> updatePool;
+
+// Below this many nodes the update is not worth splitting
+const unsigned int PARALLEL_UPDATE_THRESHOLD = 4096;
+const unsigned int MIN_UPDATE_GRAIN = 256;
+
+// Pick the free slot closest after `near`, falling back to the first free slot and only then growing the pool
+uint32_t allocateSlot(uint32_t near) {
+	SceneNodePool& pool = sceneNodePool;
+	if (!pool.freeSlots.empty()) {
+		auto slot = pool.freeSlots.lower_bound(near);
+		if (slot == pool.freeSlots.end()) {
+			slot = pool.freeSlots.begin();
+		}
+		uint32_t index = *slot;
+		pool.freeSlots.erase(slot);
+		return index;
+	}
+
+	uint32_t index = pool.generation.size();
+	assert(index <= SceneNodeHandle::INDEX_MASK && "SceneNodePool is full");
+	if (index % SceneNodePool::CHUNK_SIZE == 0) {
+		pool.chunks.emplace_back(new SceneNode[SceneNodePool::CHUNK_SIZE]);
+	}
+	pool.generation.push_back(1);
+	return index;
+}
+
+SceneNodeHandle createSceneNode(SceneNodeType nodeType, SceneNodeHandle parent) {
+	const uint32_t slot = allocateSlot(parent.isNull() ? 0 : parent.index());
+	sceneNodePool.liveCount++;
+
+	SceneNodeHandle handle;
+	handle.id = (uint32_t(sceneNodePool.generation[slot]) << SceneNodeHandle::INDEX_BITS) | slot;
+
+	SceneNode& node = sceneNodePool.at(slot);
+	node = SceneNode(nodeType);
+
+	// New nodes are roots until attached, so appending keeps the parent-before-child order
+	node.transformIndex = sceneTransforms.nodes.size();
+	sceneTransforms.parent.push_back(-1);
+	sceneTransforms.nodes.push_back(handle);
+	sceneTransforms.position.push_back(glm::vec3(0, 0, 0));
+	sceneTransforms.rotation.push_back(glm::vec3(0, 0, 0));
+	sceneTransforms.scale.push_back(glm::vec3(1, 1, 1));
+	sceneTransforms.referencePoint.push_back(glm::vec3(0, 0, 0));
+	sceneTransforms.local.push_back(glm::mat4(1.0f));
+	sceneTransforms.world.push_back(glm::mat4(1.0f));
+	sceneTransforms.normal.push_back(glm::mat3(1.0f));
+	sceneTransforms.needsNormal.push_back((nodeType & (GEOMETRY | GEOMETRY_NORMAL_MAPPED)) > 0);
+	sceneTransforms.uniformScale.push_back(true);
+	sceneTransforms.localDirty.push_back(true);
+	sceneTransforms.worldDirty.push_back(true);
+	sceneTransforms.localBounds.push_back(Bounds());
+	sceneTransforms.hasBounds.push_back(false);
+	sceneTransforms.worldBounds.push_back(AABB());
+	sceneTransforms.worldSphere.push_back(BoundingSphere());
+	sceneTransforms.subtreeSize.push_back(1);
+	// Appending keeps the order valid, but the work split needs to include the new entry
+	sceneTransforms.orderDirty = true;
+
+	if (!parent.isNull()) {
+		addChild(parent, handle);
+	}
+
+	return handle;
+}
+
+// Put `node` and its descendants in the layers of their type.
+// Their BVH leaves are created again by the next refit, which the dirty root forces
+void enterLayers(SceneNode* node) {
+	sceneTransforms.localDirty[node->transformIndex] = true;
+	std::vector<SceneNode*> stack = { node };
+	while (!stack.empty()) {
+		SceneNode* current = stack.back();
+		stack.pop_back();
+		current->inScene = true;
+		const int layer = renderLayer(current->nodeType);
+		if (layer != -1) {
+			current->layerIndex = renderLayers[layer].size();
+			renderLayers[layer].push_back(current);
+		}
+		for (SceneNodeHandle child : current->children) {
+			stack.push_back(child.get());
+		}
+	}
+}
+
+// Take `node` and its descendants out of the layers and the BVH, so culling and queries no longer see them
+void leaveLayers(SceneNode* node) {
+	std::vector<SceneNode*> stack = { node };
+	while (!stack.empty()) {
+		SceneNode* current = stack.back();
+		stack.pop_back();
+		current->inScene = false;
+		if (current->cullingProxy != DynamicAABBTree::NULL_NODE) {
+			sceneBVH.destroyProxy(current->cullingProxy);
+			current->cullingProxy = DynamicAABBTree::NULL_NODE;
+		}
+		if (current->layerIndex != -1) {
+			std::vector<SceneNode*>& members = renderLayers[renderLayer(current->nodeType)];
+			SceneNode* last = members.back();
+			members[current->layerIndex] = last;
+			last->layerIndex = current->layerIndex;
+			members.pop_back();
+			current->layerIndex = -1;
+		}
+		for (SceneNodeHandle child : current->children) {
+			stack.push_back(child.get());
+		}
+	}
+}
+
+// Release the slot, BVH leaf and transform entry of a node, its parent and children are not touched
+void freeSceneNode(SceneNodeHandle handle) {
+	SceneNode* node = handle.get();
+	if (node->cullingProxy != DynamicAABBTree::NULL_NODE) {
+		sceneBVH.destroyProxy(node->cullingProxy);
+	}
+
+	// The transform entry is dropped the next time the order is rebuilt
+	sceneTransforms.nodes[node->transformIndex] = SceneNodeHandle();
+	sceneTransforms.orderDirty = true;
+
+	// Release the children storage and invalidate all handles to the slot
+	*node = SceneNode();
+	const uint32_t slot = handle.index();
+	uint16_t& generation = sceneNodePool.generation[slot];
+	generation = (generation + 1) & SceneNodeHandle::GENERATION_MASK;
+	if (generation == 0) generation = 1;
+	sceneNodePool.freeSlots.insert(slot);
+	sceneNodePool.liveCount--;
+}
+
+void destroySceneNode(SceneNodeHandle handle) {
+	SceneNode* node = handle.get();
+	if (node == nullptr) {
+		return;
+	}
+
+	if (!node->parent.isNull()) {
+		removeChild(node->parent, handle);
+	}
+	else if (node->inScene) {
+		leaveLayers(node);
+	}
+
+	// Parents are collected before their children, so freeing in reverse frees the children first.
+	// The whole subtree goes, so the children are not unlinked from each other
+	std::vector<SceneNodeHandle> subtree = { handle };
+	for (size_t i = 0; i < subtree.size(); i++) {
+		const std::vector<SceneNodeHandle>& children = subtree[i]->children;
+		subtree.insert(subtree.end(), children.begin(), children.end());
+	}
+	for (size_t i = subtree.size(); i-- > 0;) {
+		freeSceneNode(subtree[i]);
+	}
+}
+
+// Unlink a child from its parent without changing the layers, returns false if it wasn't a child
+bool detachChild(SceneNodeHandle parent, SceneNodeHandle child) {
+	auto position = std::find(parent->children.begin(), parent->children.end(), child);
+	if (position == parent->children.end()) {
+		return false;
+	}
+
+	parent->children.erase(position);
+	child->parent = SceneNodeHandle();
+	sceneTransforms.localDirty[child->transformIndex] = true;
+	sceneTransforms.orderDirty = true;
+	return true;
+}
+
+void setSceneRoot(SceneNodeHandle root) {
+	if (!root->inScene) {
+		enterLayers(root.get());
+	}
 }
 
 // Add a child node to its parent's list of children
-void addChild(SceneNode* parent, SceneNode* child) {
+void addChild(SceneNodeHandle parent, SceneNodeHandle child) {
+	if (child->parent == parent) {
+		return;
+	}
+	if (!child->parent.isNull()) {
+		detachChild(child->parent, child);
+	}
+
 	parent->children.push_back(child);
+	child->parent = parent;
+	// The local transform is the same, but it is now relative to a different parent
+	sceneTransforms.localDirty[child->transformIndex] = true;
+	sceneTransforms.orderDirty = true;
+
+	// Moving a subtree within the scene keeps it in the layers
+	if (parent->inScene && !child->inScene) {
+		enterLayers(child.get());
+	}
+	else if (!parent->inScene && child->inScene) {
+		leaveLayers(child.get());
+	}
 }
 
-int totalChildren(SceneNode* parent) {
-	int count = parent->children.size();
-	for (SceneNode* child : parent->children) {
-		count += totalChildren(child);
+// Remove a child node from its parent, the child becomes a root node and leaves the scene
+void removeChild(SceneNodeHandle parent, SceneNodeHandle child) {
+	if (detachChild(parent, child) && child->inScene) {
+		leaveLayers(child.get());
+	}
+}
+
+int totalChildren(SceneNodeHandle parent) {
+	// The subtree sizes are only valid while the order is
+	if (!sceneTransforms.orderDirty) {
+		return sceneTransforms.subtreeSize[parent->transformIndex] - 1;
+	}
+
+	int count = 0;
+	std::vector<SceneNodeHandle> stack(parent->children.begin(), parent->children.end());
+	while (!stack.empty()) {
+		SceneNode* node = stack.back().get();
+		stack.pop_back();
+		count++;
+		stack.insert(stack.end(), node->children.begin(), node->children.end());
 	}
 	return count;
 }
 
+template <class T> void permute(std::vector<T>& data, const std::vector<unsigned int>& order) {
+	std::vector<T> sorted;
+	sorted.reserve(order.size());
+	for (unsigned int from : order) {
+		sorted.push_back(data[from]);
+	}
+	data.swap(sorted);
+}
+
+// Rebuild the depth first order of the transform arrays. Only runs after the hierarchy changed.
+void sortSceneTransforms() {
+	SceneTransforms& st = sceneTransforms;
+	const unsigned int count = st.nodes.size();
+
+	std::vector<unsigned int> order;
+	order.reserve(count);
+	std::vector<SceneNodeHandle> stack;
+
+	for (unsigned int i = 0; i < count; i++) {
+		// Entries of destroyed nodes are skipped, which removes them from the arrays
+		if (st.nodes[i].isNull() || !st.nodes[i]->parent.isNull()) continue;
+
+		stack.push_back(st.nodes[i]);
+		while (!stack.empty()) {
+			SceneNode* node = stack.back().get();
+			stack.pop_back();
+			order.push_back(node->transformIndex);
+			// Push in reverse so children keep their relative order
+			for (auto child = node->children.rbegin(); child != node->children.rend(); ++child) {
+				stack.push_back(*child);
+			}
+		}
+	}
+
+	permute(st.nodes, order);
+	permute(st.position, order);
+	permute(st.rotation, order);
+	permute(st.scale, order);
+	permute(st.referencePoint, order);
+	permute(st.local, order);
+	permute(st.world, order);
+	permute(st.normal, order);
+	permute(st.needsNormal, order);
+	permute(st.uniformScale, order);
+	permute(st.localDirty, order);
+	permute(st.worldDirty, order);
+	permute(st.localBounds, order);
+	permute(st.hasBounds, order);
+	permute(st.worldBounds, order);
+	permute(st.worldSphere, order);
+
+	const unsigned int liveCount = order.size();
+	for (unsigned int i = 0; i < liveCount; i++) {
+		st.nodes[i]->transformIndex = i;
+	}
+	st.parent.resize(liveCount);
+	for (unsigned int i = 0; i < liveCount; i++) {
+		SceneNodeHandle parent = st.nodes[i]->parent;
+		st.parent[i] = parent.isNull() ? -1 : int(parent->transformIndex);
+	}
+
+	// Children come after their parent, so walking backwards accumulates every subtree
+	st.subtreeSize.assign(liveCount, 1);
+	for (unsigned int i = liveCount; i-- > 0;) {
+		if (st.parent[i] >= 0) st.subtreeSize[st.parent[i]] += st.subtreeSize[i];
+	}
+
+	st.orderDirty = false;
+	updatePartition.dirty = true;
+}
+
+// Split the transform arrays into subtree ranges that can be updated independently.
+// Subtrees larger than the grain are split further, their roots are updated serially first.
+void partitionSceneTransforms() {
+	SceneTransforms& st = sceneTransforms;
+	UpdatePartition& partition = updatePartition;
+	const unsigned int count = st.nodes.size();
+	const unsigned int threads = updatePool ? updatePool->size() : 1;
+	// A few tasks per thread so work stealing can even out unbalanced subtrees
+	const unsigned int grain = std::max(MIN_UPDATE_GRAIN, count / (threads * 8));
+
+	partition.serialNodes.clear();
+	partition.ranges.clear();
+
+	unsigned int i = 0;
+	while (i < count) {
+		const unsigned int size = st.subtreeSize[i];
+		if (size > grain) {
+			// The next entry is the first child, so this descends into the subtree
+			partition.serialNodes.push_back(i);
+			i++;
+			continue;
+		}
+
+		// Merge neighbouring small subtrees into one task
+		if (!partition.ranges.empty()
+			&& partition.ranges.back().second == i
+			&& partition.ranges.back().second - partition.ranges.back().first < grain) {
+			partition.ranges.back().second = i + size;
+		}
+		else {
+			partition.ranges.push_back({ i, i + size });
+		}
+		i += size;
+	}
+
+	partition.scratch.resize(partition.ranges.size());
+	partition.dirty = false;
+}
+
+void setSceneUpdateThreads(unsigned int threadCount) {
+	if (threadCount <= 1) {
+		updatePool.reset();
+	}
+	else {
+		updatePool.reset(new ThreadPool(threadCount));
+	}
+	updatePartition.dirty = true;
+}
+
+inline void updateEntry(SceneTransforms& st, unsigned int i, UpdateScratch& scratch) {
+	// Parents are always stored before their children, so the parent dirty state is already known
+	const int parent = st.parent[i];
+	const bool parentMoved = parent >= 0 && st.worldDirty[parent];
+	st.worldDirty[i] = st.localDirty[i] || parentMoved;
+	if (!st.worldDirty[i]) return;
+	st.localDirty[i] = false;
+
+	st.world[i] = parent < 0 ? st.local[i] : st.world[parent] * st.local[i];
+
+	const glm::vec3& scale = st.scale[i];
+	const bool localUniform = scale.x == scale.y && scale.y == scale.z;
+	st.uniformScale[i] = localUniform && (parent < 0 || st.uniformScale[parent]);
+
+	if (st.needsNormal[i]) {
+		(st.uniformScale[i] ? scratch.dirtyUniformNormals : scratch.dirtyNormals).push_back(i);
+	}
+
+	if (st.hasBounds[i]) {
+		st.worldBounds[i] = transformAABB(st.world[i], st.localBounds[i].box);
+		st.worldSphere[i] = transformSphere(st.world[i], st.localBounds[i].sphere);
+		scratch.dirtyBounds.push_back(i);
+	}
+
+	scratch.recomputedNodes++;
+}
+
+// Update the entries in `indices`, which must be sorted and have up to date parents outside of the list
+template <class Indices> void updateEntries(const Indices& indices, UpdateScratch& scratch) {
+	SceneTransforms& st = sceneTransforms;
+	scratch.dirtyLocals.clear();
+	scratch.dirtyNormals.clear();
+	scratch.dirtyUniformNormals.clear();
+	scratch.dirtyBounds.clear();
+	scratch.recomputedNodes = 0;
+
+	// Local matrices don't depend on each other, so they are composed in batches up front
+	for (unsigned int i : indices) {
+		if (st.localDirty[i]) scratch.dirtyLocals.push_back(i);
+	}
+	composeTransforms(scratch.dirtyLocals.data(), scratch.dirtyLocals.size(),
+		st.position.data(), st.referencePoint.data(), st.rotation.data(), st.scale.data(), st.local.data());
+
+	for (unsigned int i : indices) {
+		updateEntry(st, i, scratch);
+	}
+
+	// Calculate the normal transformations
+	computeNormalMatrices(scratch.dirtyNormals.data(), scratch.dirtyNormals.size(), st.world.data(), st.normal.data());
+	computeUniformNormalMatrices(scratch.dirtyUniformNormals.data(), scratch.dirtyUniformNormals.size(), st.world.data(), st.normal.data());
+}
+
+// Iterates [begin, end) without materializing the indices
+struct IndexRange {
+	struct iterator {
+		unsigned int value;
+		unsigned int operator*() const { return value; }
+		iterator& operator++() { value++; return *this; }
+		bool operator!=(const iterator& other) const { return value != other.value; }
+	};
+	unsigned int first, last;
+	iterator begin() const { return { first }; }
+	iterator end() const { return { last }; }
+};
+
+// Node owning a leaf of sceneBVH
+SceneNodeHandle proxyHandle(int proxy) {
+	SceneNodeHandle handle;
+	handle.id = sceneBVH.getUserData(proxy);
+	return handle;
+}
+
+// Move the BVH leaves of the entries whose bounds were refit. The tree is shared, so this runs on one thread
+void refitSceneBVH(const UpdateScratch& scratch) {
+	SceneTransforms& st = sceneTransforms;
+	for (unsigned int i : scratch.dirtyBounds) {
+		SceneNode* node = st.nodes[i].get();
+		// UI is placed in screen space and never culled, detached subtrees get no leaves until they are added back
+		if (node->nodeType == GEOMETRY_2D || !node->inScene) continue;
+
+		cullingStats.boundsRefit++;
+		if (node->cullingProxy == DynamicAABBTree::NULL_NODE) {
+			node->cullingProxy = sceneBVH.createProxy(st.worldBounds[i], st.nodes[i].id);
+		}
+		else if (sceneBVH.moveProxy(node->cullingProxy, st.worldBounds[i])) {
+			cullingStats.proxiesReinserted++;
+		}
+	}
+}
+
+void updateNodeTransformations() {
+	SceneTransforms& st = sceneTransforms;
+	UpdatePartition& partition = updatePartition;
+	if (st.orderDirty) {
+		sortSceneTransforms();
+	}
+
+	cullingStats.boundsRefit = 0;
+	cullingStats.proxiesReinserted = 0;
+
+	const unsigned int count = st.nodes.size();
+	if (!updatePool || count < PARALLEL_UPDATE_THRESHOLD) {
+		updateEntries(IndexRange{ 0, count }, partition.serialScratch);
+		st.recomputedNodes = partition.serialScratch.recomputedNodes;
+		refitSceneBVH(partition.serialScratch);
+		return;
+	}
+
+	if (partition.dirty) {
+		partitionSceneTransforms();
+	}
+
+	// Ancestors of the ranges first, then every range on its own task.
+	// Each entry is computed the same way no matter which thread runs it, so the result matches the serial path
+	updateEntries(partition.serialNodes, partition.serialScratch);
+	updatePool->parallelFor(partition.ranges.size(), [&](unsigned int task) {
+		const std::pair<unsigned int, unsigned int>& range = partition.ranges[task];
+		updateEntries(IndexRange{ range.first, range.second }, partition.scratch[task]);
+	});
+
+	st.recomputedNodes = partition.serialScratch.recomputedNodes;
+	refitSceneBVH(partition.serialScratch);
+	for (const UpdateScratch& scratch : partition.scratch) {
+		st.recomputedNodes += scratch.recomputedNodes;
+		refitSceneBVH(scratch);
+	}
+}
+
+void cullSceneNodes(const glm::mat4& viewProjection) {
+	CullingStats& stats = cullingStats;
+	stats.frame++;
+	stats.leavesTested = 0;
+	stats.visible = 0;
+
+	const Frustum frustum = extractFrustum(viewProjection);
+	stats.treeNodesTested = sceneBVH.queryFrustum(frustum, [&](int proxy, bool fullyInside) {
+		SceneNode* node = proxyHandle(proxy).get();
+
+		// Fat boxes are larger than the node, so leaves crossing a plane are tested again with the
+		// tight bounds. The sphere is the cheaper test, so it goes first
+		if (!fullyInside) {
+			stats.leavesTested++;
+			const FrustumTest sphereTest = testSphere(frustum, node->getWorldSphere());
+			if (sphereTest == FRUSTUM_OUTSIDE) return;
+			if (sphereTest == FRUSTUM_INTERSECTS && testAABB(frustum, node->getWorldBounds()) == FRUSTUM_OUTSIDE) return;
+		}
+
+		node->visibleFrame = stats.frame;
+		stats.visible++;
+	});
+
+	stats.proxies = sceneBVH.proxyCount();
+	stats.culled = stats.proxies - stats.visible;
+}
+
+bool raycastScene(const Ray& ray, RayHit& hit, SceneNodeHandle ignore) {
+	const glm::vec3 inverseDirection = 1.0f / ray.direction;
+	hit = RayHit();
+	sceneBVH.queryRay(ray, [&](int proxy, float maxDistance) {
+		const SceneNodeHandle handle = proxyHandle(proxy);
+		if (handle == ignore) {
+			return maxDistance;
+		}
+		const SceneNode* node = handle.get();
+		// The fat box was hit, test the tight bounds. A negative enter distance means the origin is inside
+		float enter, leave;
+		intersectSlabs(node->getWorldBounds(), ray.origin, inverseDirection, enter, leave);
+		if (enter > leave || enter < 0 || enter > maxDistance) {
+			return maxDistance;
+		}
+		hit.node = handle;
+		hit.distance = enter;
+		return enter;
+	});
+	if (hit.node.isNull()) {
+		return false;
+	}
+	hit.point = ray.origin + ray.direction * hit.distance;
+	return true;
+}
+
+void raycastScene(const std::vector<Ray>& rays, std::vector<RayHit>& hits, SceneNodeHandle ignore) {
+	hits.resize(rays.size());
+	for (size_t i = 0; i < rays.size(); i++) {
+		raycastScene(rays[i], hits[i], ignore);
+	}
+}
+
+void overlapScene(const BoundingSphere& sphere, std::vector<SceneNodeHandle>& overlapping) {
+	overlapping.clear();
+	AABB box;
+	box.min = sphere.center - glm::vec3(sphere.radius);
+	box.max = sphere.center + glm::vec3(sphere.radius);
+	sceneBVH.queryOverlap(box, [&](int proxy) {
+		const SceneNodeHandle handle = proxyHandle(proxy);
+		if (overlaps(handle->getWorldBounds(), sphere)) {
+			overlapping.push_back(handle);
+		}
+	});
+}
+
+void nearestSceneNodes(const glm::vec3& point, unsigned int k, std::vector<SceneNodeHandle>& nearest, float maxDistance) {
+	nearest.clear();
+	if (k == 0) {
+		return;
+	}
+	// Closest first, k is expected to be small so a sorted insert is cheaper than a heap
+	std::vector<std::pair<float, SceneNodeHandle>> found;
+	sceneBVH.queryNearest(point, maxDistance * maxDistance, [&](int proxy, float maxDistance2) {
+		const SceneNodeHandle handle = proxyHandle(proxy);
+		const float nodeDistance2 = distance2(handle->getWorldBounds(), point);
+		if (nodeDistance2 > maxDistance2) {
+			return maxDistance2;
+		}
+		auto position = std::upper_bound(found.begin(), found.end(), nodeDistance2,
+			[](float value, const std::pair<float, SceneNodeHandle>& entry) { return value < entry.first; });
+		found.insert(position, { nodeDistance2, handle });
+		if (found.size() > k) {
+			found.pop_back();
+		}
+		return found.size() == k ? found.back().first : maxDistance2;
+	});
+	for (const auto& entry : found) {
+		nearest.push_back(entry.second);
+	}
+}
+
+// A coarser level of detail is only picked once its error is below this fraction of the limit
+const float LOD_HYSTERESIS = 0.75f;
+
+unsigned int selectNodeLOD(SceneNode& node, const float* errors, unsigned int lodCount, const LODSettings& settings) {
+	assert(lodCount > 0 && "Meshes have at least the full detail level");
+	const BoundingSphere& sphere = node.getWorldSphere();
+	// Distance to the closest point of the bounds, the error can be on the near side of the mesh
+	const float distance = std::max(glm::length(sphere.center - settings.viewPosition) - sphere.radius, 1e-3f);
+	const float pixelsPerError = sphere.radius / distance * settings.pixelsPerUnit;
+
+	unsigned int lod = std::min(node.lod, lodCount - 1);
+	while (lod > 0 && errors[lod] * pixelsPerError > settings.maxPixelError) {
+		lod--;
+	}
+	while (lod + 1 < lodCount && errors[lod + 1] * pixelsPerError < settings.maxPixelError * LOD_HYSTERESIS) {
+		lod++;
+	}
+	node.lod = lod;
+	return lod;
+}
+
 // Pretty prints the current values of a SceneNode instance to stdout
-void printNode(SceneNode* node) {
+void printNode(SceneNodeHandle node) {
+	const glm::vec3& rotation = node->getRotation();
+	const glm::vec3& position = node->getPosition();
+	const glm::vec3& referencePoint = node->getReferencePoint();
 	printf(
 		"SceneNode {\n"
 		"    Child count: %i\n"
@@ -29,10 +640,9 @@ void printNode(SceneNode* node) {
 		"    VAO ID: %i\n"
 		"}\n",
 		int(node->children.size()),
-		node->rotation.x, node->rotation.y, node->rotation.z,
-		node->position.x, node->position.y, node->position.z,
-		node->referencePoint.x, node->referencePoint.y, node->referencePoint.z, 
+		rotation.x, rotation.y, rotation.z,
+		position.x, position.y, position.z,
+		referencePoint.x, referencePoint.y, referencePoint.z,
 		node->vertexArrayObjectID
 	);
 }
-
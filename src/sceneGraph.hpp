@@ -9,10 +9,17 @@
 #include <vector>
 #include <cstdio>
 #include <stdbool.h>
-#include <cstdlib> 
-#include <ctime> 
+#include <cstdlib>
+#include <ctime>
 #include <chrono>
 #include <fstream>
+#include <set>
+#include <memory>
+#include <cstdint>
+#include <cassert>
+
+#include "utilities/bounds.hpp"
+#include "utilities/dynamicAABBTree.hpp"
 
 enum SceneNodeType {
 	EMPTY					= 0b000001,
@@ -23,42 +30,188 @@ enum SceneNodeType {
 	SPOT_LIGHT				= 0b100000,
 };
 
-struct SceneNode {
-	SceneNode(SceneNodeType type) {
-		position	= glm::vec3(0, 0, 0);
-		rotation	= glm::vec3(0, 0, 0);
-		scale		= glm::vec3(1, 1, 1);
+// Flat lists of the nodes of one kind in the scene, so a pass only visits the nodes it draws
+enum RenderLayer {
+	LAYER_GEOMETRY,			// GEOMETRY
+	LAYER_NORMAL_MAPPED,	// GEOMETRY_NORMAL_MAPPED
+	LAYER_UI,				// GEOMETRY_2D
+	LAYER_LIGHTS,			// POINT_LIGHT and SPOT_LIGHT
+	MAX_RENDER_LAYERS		// !Always last entry!
+};
+
+// -1 for node types that are not in a layer
+inline int renderLayer(SceneNodeType type) {
+	switch (type) {
+	case GEOMETRY: return LAYER_GEOMETRY;
+	case GEOMETRY_NORMAL_MAPPED: return LAYER_NORMAL_MAPPED;
+	case GEOMETRY_2D: return LAYER_UI;
+	case POINT_LIGHT:
+	case SPOT_LIGHT: return LAYER_LIGHTS;
+	default: return -1;
+	}
+}
+
+struct SceneNode;
+
+// Generational handle to a pooled SceneNode. The low 20 bits index the pool slot and the
+// high 12 bits hold the generation of that slot, so a handle to a destroyed node is detected
+// even after its slot has been reused. Generations start at 1, which makes 0 the null handle.
+struct SceneNodeHandle {
+	static const uint32_t INDEX_BITS = 20;
+	static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+	static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+	uint32_t id = 0;
+
+	uint32_t index() const { return id & INDEX_MASK; }
+	uint32_t generation() const { return id >> INDEX_BITS; }
+	bool isNull() const { return id == 0; }
+	// Resolves to nullptr when the node has been destroyed
+	SceneNode* get() const;
+	SceneNode* operator->() const;
+
+	bool operator==(const SceneNodeHandle& other) const { return id == other.id; }
+	bool operator!=(const SceneNodeHandle& other) const { return id != other.id; }
+};
+
+// Flat transform hierarchy stored as a structure of arrays. Entries are kept in
+// parent-before-child (depth first) order, which means that a parent's world
+// transform is always computed before any of its children and the whole scene
+// can be updated in one linear sweep over contiguous memory.
+// Entries are indexed by SceneNode::transformIndex, which changes whenever the
+// hierarchy is reordered.
+struct SceneTransforms {
+	// Index of the parent entry, -1 for root nodes
+	std::vector<int> parent;
+	// Back reference to the node owning each entry
+	std::vector<SceneNodeHandle> nodes;
+
+	// Local transform relative to the parent
+	std::vector<glm::vec3> position;
+	std::vector<glm::vec3> rotation;
+	std::vector<glm::vec3> scale;
+	std::vector<glm::vec3> referencePoint;
+
+	// Cached local matrix, world transform and the matrix used to transform the mesh normals
+	std::vector<glm::mat4> local;
+	std::vector<glm::mat4> world;
+	std::vector<glm::mat3> normal;
+	// Only geometry needs a normal matrix, avoids the inverse for everything else
+	std::vector<unsigned char> needsNormal;
+	// Set when the world transform has uniform scale, which lets the normal matrix skip the inverse
+	std::vector<unsigned char> uniformScale;
 
-		referencePoint		= glm::vec3(0, 0, 0);
+	// Set by the setters when the local transform changed since the last update
+	std::vector<unsigned char> localDirty;
+	// Set during the update for every node whose world transform was recomputed,
+	// children use this to find out if their parent moved
+	std::vector<unsigned char> worldDirty;
+
+	// Mesh bounds in local space, only nodes with geometry have bounds
+	std::vector<Bounds> localBounds;
+	std::vector<unsigned char> hasBounds;
+	// Bounds refit whenever the world transform is recomputed
+	std::vector<AABB> worldBounds;
+	std::vector<BoundingSphere> worldSphere;
+
+	// Number of entries in the subtree starting at each entry, including itself.
+	// Because of the depth first order a subtree is the contiguous range [i, i + subtreeSize[i])
+	std::vector<unsigned int> subtreeSize;
+
+	// Set when nodes are attached, detached or destroyed and the order has to be rebuilt
+	bool orderDirty = false;
+
+	// Number of nodes whose world transform was recomputed by the last update
+	unsigned int recomputedNodes = 0;
+
+	void setLocalBounds(unsigned int index, const Bounds& bounds) {
+		localBounds[index] = bounds;
+		hasBounds[index] = true;
+		localDirty[index] = true;
+	}
+
+	// Write a local transform value and mark the entry dirty if it changed
+	template <class T> void set(std::vector<T>& data, unsigned int index, const T& value) {
+		if (data[index] == value) return;
+		data[index] = value;
+		localDirty[index] = true;
+	}
+};
+
+extern SceneTransforms sceneTransforms;
+
+struct SceneNode {
+	SceneNode(SceneNodeType type = EMPTY) {
+		transformIndex		= 0;
 		vertexArrayObjectID = -1;
+		meshID				= -1;
 		diffuseID			= 0;
 		normalMapID			= 0;
 		roughnessID			= 0;
 		VAOIndexCount		= 0;
+		cullingProxy		= DynamicAABBTree::NULL_NODE;
+		visibleFrame		= 0;
+		inScene				= false;
+		layerIndex			= -1;
+		lod					= 0;
 
 		nodeType = type;
 	}
 
 	// A list of all children that belong to this node.
 	// For instance, in case of the scene graph of a human body shown in the assignment text, the "Upper Torso" node would contain the "Left Arm", "Right Arm", "Head" and "Lower Torso" nodes in its list of children.
-	std::vector<SceneNode*> children;
-	
-	// The node's position and rotation relative to its parent
-	glm::vec3 position;
-	glm::vec3 rotation;
-	glm::vec3 scale;
-
-	// A transformation matrix representing the transformation of the node's location relative to its parent. This matrix is updated every frame.
-	glm::mat4 currentTransformationMatrix;
-	// A transformation matrix used to transform the mesh normals
-	glm::mat3 normalMatrix;
+	// Use addChild/removeChild so that the transform order is kept up to date.
+	std::vector<SceneNodeHandle> children;
+	SceneNodeHandle parent;
 
+	// Index into sceneTransforms
+	unsigned int transformIndex;
+
+	// The node's position, rotation and scale relative to its parent.
+	// Setters only mark the node dirty when the value actually changes
+	const glm::vec3& getPosition() const { return sceneTransforms.position[transformIndex]; }
+	const glm::vec3& getRotation() const { return sceneTransforms.rotation[transformIndex]; }
+	const glm::vec3& getScale() const { return sceneTransforms.scale[transformIndex]; }
 	// The location of the node's reference point
-	glm::vec3 referencePoint;
+	const glm::vec3& getReferencePoint() const { return sceneTransforms.referencePoint[transformIndex]; }
+
+	void setPosition(const glm::vec3& position) { sceneTransforms.set(sceneTransforms.position, transformIndex, position); }
+	void setRotation(const glm::vec3& rotation) { sceneTransforms.set(sceneTransforms.rotation, transformIndex, rotation); }
+	void setScale(const glm::vec3& scale) { sceneTransforms.set(sceneTransforms.scale, transformIndex, scale); }
+	void setReferencePoint(const glm::vec3& referencePoint) { sceneTransforms.set(sceneTransforms.referencePoint, transformIndex, referencePoint); }
+
+	// A transformation matrix representing the transformation of the node's location relative to the world.
+	// This matrix is updated whenever the node or one of its ancestors has changed.
+	const glm::mat4& getTransformationMatrix() const { return sceneTransforms.world[transformIndex]; }
+	// A transformation matrix used to transform the mesh normals
+	const glm::mat3& getNormalMatrix() const { return sceneTransforms.normal[transformIndex]; }
+
+	// Bounds of the node's mesh, usually the bounds returned by generateBuffer.
+	// World bounds are refit with the world transform, nodes without bounds are never culled
+	void setLocalBounds(const Bounds& bounds) { sceneTransforms.setLocalBounds(transformIndex, bounds); }
+	bool hasBounds() const { return sceneTransforms.hasBounds[transformIndex]; }
+	const AABB& getWorldBounds() const { return sceneTransforms.worldBounds[transformIndex]; }
+	const BoundingSphere& getWorldSphere() const { return sceneTransforms.worldSphere[transformIndex]; }
+
+	// Leaf of the node in sceneBVH, NULL_NODE for nodes without bounds
+	int cullingProxy;
+	// Value of cullingStats.frame the last time the node passed the frustum test
+	unsigned int visibleFrame;
+	// Nodes that are not in the BVH are always visible
+	bool isCulled() const;
+
+	// Set while the node is attached below a scene root, see setSceneRoot
+	bool inScene;
+	// Position in renderLayers[renderLayer(nodeType)] while in the scene, -1 otherwise
+	int layerIndex;
 
 	// The ID of the VAO containing the "appearance" of this SceneNode.
 	int vertexArrayObjectID;
 	unsigned int VAOIndexCount;
+	// 3D nodes are drawn from the geometry heap instead, this is the ID of their mesh in the heap
+	int meshID;
+	// Level of detail of the mesh picked by the last selectNodeLOD, 0 is the full detail mesh
+	unsigned int lod;
 
 	// Node type is used to determine how to handle the contents of a node
 	SceneNodeType nodeType;
@@ -69,9 +222,115 @@ struct SceneNode {
 	GLuint roughnessID;
 };
 
-SceneNode* createSceneNode(SceneNodeType type);
-void addChild(SceneNode* parent, SceneNode* child);
-void printNode(SceneNode* node);
-int totalChildren(SceneNode* parent);
+// Pool of SceneNodes. Nodes live in fixed size chunks so their addresses never change,
+// and destroyed slots are put on a free list that is reused before the pool grows.
+struct SceneNodePool {
+	static const uint32_t CHUNK_SIZE = 1024;
+
+	std::vector<std::unique_ptr<SceneNode[]>> chunks;
+	std::vector<uint16_t> generation;
+	// Kept ordered so new nodes can be placed in the closest free slot after their parent
+	std::set<uint32_t> freeSlots;
+	uint32_t liveCount = 0;
+
+	SceneNode& at(uint32_t slot) { return chunks[slot / CHUNK_SIZE][slot % CHUNK_SIZE]; }
+};
+
+extern SceneNodePool sceneNodePool;
+
+inline SceneNode* SceneNodeHandle::get() const {
+	const uint32_t slot = index();
+	if (isNull() || slot >= sceneNodePool.generation.size() || sceneNodePool.generation[slot] != generation()) {
+		return nullptr;
+	}
+	return &sceneNodePool.at(slot);
+}
+
+inline SceneNode* SceneNodeHandle::operator->() const {
+	SceneNode* node = get();
+	assert(node != nullptr && "SceneNodeHandle refers to a destroyed node");
+	return node;
+}
+
+// Nodes below a scene root, by layer. Kept up to date when nodes are attached, detached or destroyed.
+// The order within a layer is arbitrary, removing a node moves the last node of the layer into its place
+extern std::vector<SceneNode*> renderLayers[MAX_RENDER_LAYERS];
+
+// Bounding volume hierarchy over the world bounds of every 3D node with bounds, refit by updateNodeTransformations
+extern DynamicAABBTree sceneBVH;
+
+// Per frame culling statistics
+struct CullingStats {
+	// Incremented by every cullSceneNodes call
+	unsigned int frame = 0;
+	// Set by updateNodeTransformations
+	unsigned int boundsRefit = 0;
+	unsigned int proxiesReinserted = 0;
+	// Set by cullSceneNodes
+	unsigned int proxies = 0;
+	unsigned int treeNodesTested = 0;
+	unsigned int leavesTested = 0;
+	unsigned int visible = 0;
+	unsigned int culled = 0;
+};
+
+extern CullingStats cullingStats;
+
+inline bool SceneNode::isCulled() const {
+	return cullingProxy != DynamicAABBTree::NULL_NODE && visibleFrame != cullingStats.frame;
+}
+
+// Creates a node and attaches it to `parent` if one is given. The node is allocated in the
+// free slot closest after the parent, which keeps subtrees that are built together contiguous.
+SceneNodeHandle createSceneNode(SceneNodeType type, SceneNodeHandle parent = SceneNodeHandle());
+// Destroys the node and all of its descendants, their slots are reused by later nodes
+void destroySceneNode(SceneNodeHandle node);
+// Make `root` a scene root, it and every node attached below it are put in renderLayers
+void setSceneRoot(SceneNodeHandle root);
+void addChild(SceneNodeHandle parent, SceneNodeHandle child);
+void removeChild(SceneNodeHandle parent, SceneNodeHandle child);
+void printNode(SceneNodeHandle node);
+int totalChildren(SceneNodeHandle parent);
+
+// Recompute the world transform of every dirty node and its descendants in one linear sweep.
+// Large scenes are split into independent subtree ranges that are updated in parallel
+void updateNodeTransformations();
+// Mark every node in sceneBVH that intersects the frustum of `viewProjection` as visible for this frame.
+// Must be called after updateNodeTransformations so the bounds are up to date
+void cullSceneNodes(const glm::mat4& viewProjection);
+// Closest node hit by a ray, the node is null when the ray hit nothing
+struct RayHit {
+	SceneNodeHandle node;
+	float distance = 0;
+	glm::vec3 point = glm::vec3(0, 0, 0);
+};
+
+// Spatial queries over sceneBVH, tested against the world bounds refit by the last updateNodeTransformations.
+// Only nodes in sceneBVH are found, which are the 3D nodes with bounds that are in the scene.
+// Rays don't hit nodes whose bounds contain the ray origin, and never hit `ignore`
+bool raycastScene(const Ray& ray, RayHit& hit, SceneNodeHandle ignore = SceneNodeHandle());
+// hits[i] is the closest hit of rays[i]
+void raycastScene(const std::vector<Ray>& rays, std::vector<RayHit>& hits, SceneNodeHandle ignore = SceneNodeHandle());
+// Every node whose world bounds overlap the sphere, in no particular order
+void overlapScene(const BoundingSphere& sphere, std::vector<SceneNodeHandle>& overlapping);
+// Up to k nodes closest to `point` by the distance to their world bounds, closest first.
+// Nodes further away than maxDistance are skipped
+void nearestSceneNodes(const glm::vec3& point, unsigned int k, std::vector<SceneNodeHandle>& nearest, float maxDistance = 1e30f);
+// Screen space error allowed when picking levels of detail
+struct LODSettings {
+	glm::vec3 viewPosition = glm::vec3(0, 0, 0);
+	// Pixels covered by one world unit at distance 1, the viewport height times projection[1][1] / 2
+	float pixelsPerUnit = 1;
+	// Largest error in pixels a level may have
+	float maxPixelError = 1;
+};
+
+// Pick the coarsest level of detail of the node's mesh whose error, projected at the node's distance, is within
+// maxPixelError. `errors` are relative to the mesh's bounding radius, finest first.
+// A finer level is picked as soon as the current one is too coarse, but a coarser one only once its error is
+// clearly below the limit, so nodes near the threshold don't switch back and forth every frame
+unsigned int selectNodeLOD(SceneNode& node, const float* errors, unsigned int lodCount, const LODSettings& settings);
+// Number of threads used by updateNodeTransformations, 1 or less updates on the calling thread only
+void setSceneUpdateThreads(unsigned int threadCount);
 
-// For more details, see SceneGraph.cpp.
\ No newline at end of file
+// For more details, see SceneGraph.cpp.
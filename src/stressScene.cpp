@@ -0,0 +1,212 @@
+#include "stressScene.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <fmt/format.h>
+
+// Frames skipped before measuring, the first frames grow buffers and build the BVH
+const unsigned int WARMUP_FRAMES = 30;
+
+struct StressTest {
+	bool running = false;
+	StressSettings settings;
+	SceneNodeHandle root;
+
+	unsigned int nodeCount = 0;
+	unsigned int trees = 0;
+	double buildMilliseconds = 0;
+
+	std::vector<SceneNodeHandle> dynamicNodes;
+	std::vector<float> dynamicSpeeds;
+
+	// Frames ended so far, including the warm up
+	unsigned int frame = 0;
+	StressTime frameStart;
+	double current[MAX_STRESS_PHASES] = { 0 };
+	std::vector<double> samples[MAX_STRESS_PHASES];
+	std::vector<double> visible;
+	std::vector<double> culled;
+} stressTest;
+
+const char* const PHASE_NAMES[MAX_STRESS_PHASES] = { "transform", "cull", "queue", "submit", "frame" };
+
+double millisecondsSince(StressTime start) {
+	return std::chrono::duration<double, std::milli>(stressNow() - start).count();
+}
+
+void buildStressScene(SceneNodeHandle parent, const AABB& area, int meshID, const Bounds& meshBounds, const StressSettings& settings) {
+	StressTest& test = stressTest;
+	test = StressTest();
+	test.settings = settings;
+	test.settings.nodes = std::min(std::max(settings.nodes, 1u), MAX_STRESS_NODES);
+	test.settings.depth = std::max(settings.depth, 1u);
+	test.settings.fanout = std::max(settings.fanout, 1u);
+	test.settings.dynamicRatio = std::min(std::max(settings.dynamicRatio, 0.0f), 1.0f);
+	test.settings.frames = std::max(settings.frames, 1u);
+	test.root = parent;
+	const StressSettings& s = test.settings;
+
+	// Nodes in one complete tree, the last tree is cut short when the total is reached
+	uint64_t treeSize = 0;
+	uint64_t levelSize = 1;
+	for (unsigned int level = 0; level <= s.depth && treeSize < s.nodes; level++) {
+		treeSize += levelSize;
+		levelSize *= s.fanout;
+	}
+	test.trees = unsigned((s.nodes + treeSize - 1) / treeSize);
+
+	// One grid cell of the floor per tree
+	const unsigned int gridSide = unsigned(std::ceil(std::sqrt(double(test.trees))));
+	const glm::vec3 areaSize = area.max - area.min;
+	const glm::vec2 cellSize = glm::vec2(areaSize.x, areaSize.z) / float(gridSide);
+	const glm::vec3 meshSize = meshBounds.box.max - meshBounds.box.min;
+	const float rootScale = 0.25f * std::min(cellSize.x, cellSize.y) / std::max(std::max(meshSize.x, meshSize.y), meshSize.z);
+
+	// Fixed seed so every run builds the same scene
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> fraction(0.0f, 1.0f);
+
+	StressTime start = stressNow();
+	std::vector<std::pair<SceneNodeHandle, unsigned int>> stack;
+	auto create = [&](SceneNodeHandle nodeParent, const glm::vec3& position, float scale) {
+		SceneNodeHandle node = createSceneNode(GEOMETRY, nodeParent);
+		node->meshID = meshID;
+		node->setLocalBounds(meshBounds);
+		node->setPosition(position);
+		node->setScale(glm::vec3(scale));
+		if (fraction(random) < s.dynamicRatio) {
+			test.dynamicNodes.push_back(node);
+			test.dynamicSpeeds.push_back(unit(random));
+		}
+		test.nodeCount++;
+		return node;
+	};
+
+	for (unsigned int tree = 0; tree < test.trees && test.nodeCount < s.nodes; tree++) {
+		const glm::vec2 cell(float(tree % gridSide) + 0.5f, float(tree / gridSide) + 0.5f);
+		const glm::vec3 rootPosition(
+			area.min.x + cell.x * cellSize.x,
+			area.min.y + fraction(random) * areaSize.y,
+			area.min.z + cell.y * cellSize.y);
+		stack.push_back({ create(parent, rootPosition, rootScale), 0 });
+
+		// Depth first, so every subtree is created together and ends up contiguous in the pool
+		while (!stack.empty() && test.nodeCount < s.nodes) {
+			const std::pair<SceneNodeHandle, unsigned int> entry = stack.back();
+			stack.pop_back();
+			if (entry.second == s.depth) continue;
+			for (unsigned int child = 0; child < s.fanout && test.nodeCount < s.nodes; child++) {
+				// Children are placed around their parent in its space, so they inherit its scale
+				const glm::vec3 offset = glm::vec3(unit(random), unit(random), unit(random)) * 2.0f;
+				stack.push_back({ create(entry.first, offset, 0.5f), entry.second + 1 });
+			}
+		}
+		stack.clear();
+	}
+	test.buildMilliseconds = millisecondsSince(start);
+
+	for (std::vector<double>& samples : test.samples) {
+		samples.reserve(s.frames);
+	}
+	test.frameStart = stressNow();
+	test.running = true;
+}
+
+void animateStressScene(double time) {
+	StressTest& test = stressTest;
+	for (size_t i = 0; i < test.dynamicNodes.size(); i++) {
+		test.dynamicNodes[i]->setRotation(glm::vec3(0, float(time) * test.dynamicSpeeds[i], 0));
+	}
+}
+
+void recordStressPhase(StressPhase phase, StressTime start) {
+	if (!stressTest.running) return;
+	stressTest.current[phase] += millisecondsSince(start);
+}
+
+// Percentile of sorted samples, nearest rank
+double percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) return 0;
+	size_t rank = size_t(std::ceil(p * sorted.size()));
+	return sorted[std::min(std::max(rank, size_t(1)), sorted.size()) - 1];
+}
+
+double mean(const std::vector<double>& samples) {
+	if (samples.empty()) return 0;
+	double sum = 0;
+	for (double sample : samples) sum += sample;
+	return sum / samples.size();
+}
+
+void writeStressReport() {
+	const StressTest& test = stressTest;
+	const StressSettings& s = test.settings;
+
+	// Time the traversals that are not part of every frame on the finished scene
+	StressTime start = stressNow();
+	const int descendants = totalChildren(test.root);
+	const double totalChildrenMilliseconds = millisecondsSince(start);
+
+	std::string json = "{\n";
+	json += fmt::format("  \"config\": {{ \"nodes\": {}, \"depth\": {}, \"fanout\": {}, \"dynamic_ratio\": {}, \"frames\": {}, \"warmup_frames\": {}, \"hardware_threads\": {} }},\n",
+		s.nodes, s.depth, s.fanout, s.dynamicRatio, s.frames, WARMUP_FRAMES, std::thread::hardware_concurrency());
+	json += fmt::format("  \"scene\": {{ \"stress_nodes\": {}, \"trees\": {}, \"dynamic_nodes\": {}, \"total_nodes\": {}, \"bvh_proxies\": {}, \"bvh_height\": {}, \"build_ms\": {:.3f}, \"total_children_ms\": {:.3f}, \"total_children\": {} }},\n",
+		test.nodeCount, test.trees, test.dynamicNodes.size(), sceneTransforms.nodes.size(), sceneBVH.proxyCount(), sceneBVH.height(),
+		test.buildMilliseconds, totalChildrenMilliseconds, descendants);
+	json += fmt::format("  \"culling\": {{ \"visible_mean\": {:.1f}, \"culled_mean\": {:.1f} }},\n", mean(test.visible), mean(test.culled));
+
+	json += "  \"phases\": {\n";
+	for (int phase = 0; phase < MAX_STRESS_PHASES; phase++) {
+		std::vector<double> sorted = test.samples[phase];
+		std::sort(sorted.begin(), sorted.end());
+		json += fmt::format("    \"{}\": {{ \"mean_ms\": {:.4f}, \"min_ms\": {:.4f}, \"p50_ms\": {:.4f}, \"p95_ms\": {:.4f}, \"p99_ms\": {:.4f}, \"max_ms\": {:.4f} }}{}\n",
+			PHASE_NAMES[phase], mean(sorted), sorted.empty() ? 0 : sorted.front(), percentile(sorted, 0.5),
+			percentile(sorted, 0.95), percentile(sorted, 0.99), sorted.empty() ? 0 : sorted.back(),
+			phase + 1 < MAX_STRESS_PHASES ? "," : "");
+	}
+	json += "  }\n}\n";
+
+	if (s.reportPath.empty()) {
+		std::cout << json;
+		return;
+	}
+	std::ofstream out(s.reportPath);
+	out << json;
+	if (!out) {
+		fprintf(stderr, "Could not write the stress report to %s\n", s.reportPath.c_str());
+		return;
+	}
+	std::cout << "Stress report written to " << s.reportPath << std::endl;
+}
+
+bool endStressFrame() {
+	StressTest& test = stressTest;
+	if (!test.running) return false;
+
+	StressTime now = stressNow();
+	test.current[PHASE_FRAME] = std::chrono::duration<double, std::milli>(now - test.frameStart).count();
+	test.frameStart = now;
+
+	// The first call only starts the frame timer
+	if (test.frame++ > WARMUP_FRAMES) {
+		for (int phase = 0; phase < MAX_STRESS_PHASES; phase++) {
+			test.samples[phase].push_back(test.current[phase]);
+		}
+		test.visible.push_back(cullingStats.visible);
+		test.culled.push_back(cullingStats.culled);
+	}
+	std::fill(test.current, test.current + MAX_STRESS_PHASES, 0.0);
+
+	if (test.samples[PHASE_FRAME].size() < test.settings.frames) {
+		return false;
+	}
+	test.running = false;
+	writeStressReport();
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "sceneGraph.hpp"
+
+// Parts of a frame timed by the stress test
+enum StressPhase {
+	PHASE_TRANSFORM,	// updateNodeTransformations
+	PHASE_CULL,			// cullSceneNodes
+	PHASE_QUEUE,		// Queueing the nodes of the render layers and sorting the queue
+	PHASE_SUBMIT,		// Writing the frame data and issuing the draws
+	PHASE_FRAME,		// From one updateFrame to the next, including the buffer swap
+	MAX_STRESS_PHASES	// !Always last entry!
+};
+
+struct StressSettings {
+	// Total number of generated nodes, at most MAX_STRESS_NODES
+	unsigned int nodes = 100000;
+	// Levels below each tree root, and children of every node above the last level
+	unsigned int depth = 4;
+	unsigned int fanout = 4;
+	// Fraction of the nodes that move every frame
+	float dynamicRatio = 0.1f;
+	// Frames measured after the warm up frames
+	unsigned int frames = 300;
+	// File the JSON report is written to, stdout when empty
+	std::string reportPath;
+};
+
+// Leaves room in the node pool for the game scene
+const unsigned int MAX_STRESS_NODES = 1000000;
+
+typedef std::chrono::steady_clock::time_point StressTime;
+
+// Builds a forest of trees below `parent` until `settings.nodes` nodes have been created.
+// Every node is a 3D node drawing `meshID`, the trees are spread over `area` in the space of `parent`.
+// Starts the stress test, every frame after this is measured
+void buildStressScene(SceneNodeHandle parent, const AABB& area, int meshID, const Bounds& meshBounds, const StressSettings& settings);
+// Move the dynamic nodes, `time` is in seconds
+void animateStressScene(double time);
+
+inline StressTime stressNow() { return std::chrono::steady_clock::now(); }
+// Record the time since `start` for the current frame. Does nothing when no stress test is running
+void recordStressPhase(StressPhase phase, StressTime start);
+// Ends the measured frame, returns true once every frame has been measured and the report was written
+bool endStressFrame();
@@ -0,0 +1,420 @@
+#include "blockCompress.hpp"
+#include "simd.hpp"
+#include "threadPool.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+// The texels of one block with a row of 16 floats per channel, so the per texel work runs WIDTH texels at a time
+struct alignas(32) BlockChannels {
+	float values[4][16];
+};
+
+// Interpolation weights of the 4 bit BC7 indices, out of 64
+const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+void loadChannels(const uint8_t texels[64], BlockChannels& block) {
+	for (unsigned int i = 0; i < 16; i++) {
+		for (unsigned int c = 0; c < 4; c++) {
+			block.values[c][i] = texels[i * 4 + c];
+		}
+	}
+}
+
+float sum16(const float* values) {
+	vfloat sum = vset(0);
+	for (unsigned int i = 0; i < 16; i += WIDTH) {
+		sum = vadd(sum, vload(values + i));
+	}
+	alignas(32) float lanes[WIDTH];
+	vstore(lanes, sum);
+	float total = 0;
+	for (unsigned int lane = 0; lane < WIDTH; lane++) {
+		total += lanes[lane];
+	}
+	return total;
+}
+
+// Distance of every texel along `direction`, measured from `origin`
+void project(const BlockChannels& block, unsigned int channelCount, const float origin[4], const float direction[4], float t[16]) {
+	for (unsigned int i = 0; i < 16; i += WIDTH) {
+		vfloat dot = vset(0);
+		for (unsigned int c = 0; c < channelCount; c++) {
+			dot = vadd(dot, vmul(vsub(vload(&block.values[c][i]), vset(origin[c])), vset(direction[c])));
+		}
+		vstore(&t[i], dot);
+	}
+}
+
+// Line through the texels with the least squared distance: their mean and the principal eigenvector
+// of their covariance, found by power iteration
+void principalAxis(const BlockChannels& block, unsigned int channelCount, float mean[4], float axis[4]) {
+	BlockChannels centered;
+	for (unsigned int c = 0; c < channelCount; c++) {
+		mean[c] = sum16(block.values[c]) / 16.0f;
+		for (unsigned int i = 0; i < 16; i += WIDTH) {
+			vstore(&centered.values[c][i], vsub(vload(&block.values[c][i]), vset(mean[c])));
+		}
+	}
+	float covariance[4][4];
+	alignas(32) float products[16];
+	for (unsigned int c = 0; c < channelCount; c++) {
+		for (unsigned int d = c; d < channelCount; d++) {
+			for (unsigned int i = 0; i < 16; i += WIDTH) {
+				vstore(&products[i], vmul(vload(&centered.values[c][i]), vload(&centered.values[d][i])));
+			}
+			covariance[c][d] = covariance[d][c] = sum16(products);
+		}
+	}
+
+	// Start from the covariance row of the channel that varies most, a fixed start vector can be
+	// orthogonal to the axis, like (1, 1, 1) is for a red to green gradient
+	unsigned int widest = 0;
+	for (unsigned int c = 1; c < channelCount; c++) {
+		if (covariance[c][c] > covariance[widest][widest]) widest = c;
+	}
+	for (unsigned int c = 0; c < channelCount; c++) {
+		axis[c] = covariance[widest][widest] > 1e-6f ? covariance[widest][c] : 1.0f;
+	}
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[4] = { 0, 0, 0, 0 };
+		float length = 0;
+		for (unsigned int c = 0; c < channelCount; c++) {
+			for (unsigned int d = 0; d < channelCount; d++) {
+				next[c] += covariance[c][d] * axis[d];
+			}
+			length = std::max(length, std::fabs(next[c]));
+		}
+		// All texels are the same colour, any axis will do
+		if (length < 1e-6f) break;
+		for (unsigned int c = 0; c < channelCount; c++) axis[c] = next[c] / length;
+	}
+	float lengthSquared = 0;
+	for (unsigned int c = 0; c < channelCount; c++) lengthSquared += axis[c] * axis[c];
+	for (unsigned int c = 0; c < channelCount; c++) axis[c] /= std::sqrt(lengthSquared);
+}
+
+// Endpoints where the principal axis enters and leaves the texels
+void axisEndpoints(const BlockChannels& block, unsigned int channelCount, float e0[4], float e1[4]) {
+	float mean[4];
+	float axis[4];
+	principalAxis(block, channelCount, mean, axis);
+	alignas(32) float t[16];
+	project(block, channelCount, mean, axis, t);
+	const float minimum = *std::min_element(t, t + 16);
+	const float maximum = *std::max_element(t, t + 16);
+	for (unsigned int c = 0; c < channelCount; c++) {
+		e0[c] = std::min(std::max(mean[c] + axis[c] * minimum, 0.0f), 255.0f);
+		e1[c] = std::min(std::max(mean[c] + axis[c] * maximum, 0.0f), 255.0f);
+	}
+}
+
+// Nearest of `levels` evenly spaced steps from e0 to e1 for every texel
+void selectSteps(const BlockChannels& block, unsigned int channelCount, const float e0[4], const float e1[4], unsigned int levels, float steps[16]) {
+	float direction[4];
+	float lengthSquared = 0;
+	for (unsigned int c = 0; c < channelCount; c++) {
+		direction[c] = e1[c] - e0[c];
+		lengthSquared += direction[c] * direction[c];
+	}
+	if (lengthSquared < 1e-6f) {
+		std::fill(steps, steps + 16, 0.0f);
+		return;
+	}
+	for (unsigned int c = 0; c < channelCount; c++) {
+		direction[c] *= (levels - 1) / lengthSquared;
+	}
+	project(block, channelCount, e0, direction, steps);
+	const vfloat half = vset(0.5f);
+	const vfloat first = vset(0);
+	const vfloat last = vset(float(levels - 1));
+	for (unsigned int i = 0; i < 16; i += WIDTH) {
+		vstore(&steps[i], vmin(vmax(vfloor(vadd(vload(&steps[i]), half)), first), last));
+	}
+}
+
+// Least squares endpoints for the chosen steps. False when every texel is on the same step
+bool refitEndpoints(const BlockChannels& block, unsigned int channelCount, const float steps[16], unsigned int levels, float e0[4], float e1[4]) {
+	float a00 = 0, a01 = 0, a11 = 0;
+	float b0[4] = { 0, 0, 0, 0 };
+	float b1[4] = { 0, 0, 0, 0 };
+	for (unsigned int i = 0; i < 16; i++) {
+		const float w = steps[i] / (levels - 1);
+		a00 += (1 - w) * (1 - w);
+		a01 += (1 - w) * w;
+		a11 += w * w;
+		for (unsigned int c = 0; c < channelCount; c++) {
+			b0[c] += (1 - w) * block.values[c][i];
+			b1[c] += w * block.values[c][i];
+		}
+	}
+	const float determinant = a00 * a11 - a01 * a01;
+	if (std::fabs(determinant) < 1e-6f) return false;
+	for (unsigned int c = 0; c < channelCount; c++) {
+		e0[c] = std::min(std::max((a11 * b0[c] - a01 * b1[c]) / determinant, 0.0f), 255.0f);
+		e1[c] = std::min(std::max((a00 * b1[c] - a01 * b0[c]) / determinant, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+// Writes bit fields from the lowest bit of the first byte up, the order BC7 blocks are read in
+struct BitWriter {
+	uint8_t* bytes;
+	unsigned int position;
+
+	void write(uint32_t value, unsigned int count) {
+		for (unsigned int bit = 0; bit < count; bit++, position++) {
+			if ((value >> bit) & 1) bytes[position / 8] |= uint8_t(1 << (position % 8));
+		}
+	}
+};
+
+//
+// BC1
+//
+
+uint16_t packRGB565(const float color[3]) {
+	const uint16_t r = uint16_t(std::lround(color[0] * 31 / 255));
+	const uint16_t g = uint16_t(std::lround(color[1] * 63 / 255));
+	const uint16_t b = uint16_t(std::lround(color[2] * 31 / 255));
+	return uint16_t((r << 11) | (g << 5) | b);
+}
+
+void unpackRGB565(uint16_t packed, float color[3]) {
+	const unsigned int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = float((r << 3) | (r >> 2));
+	color[1] = float((g << 2) | (g >> 4));
+	color[2] = float((b << 3) | (b >> 2));
+}
+
+// Quantized endpoints, the steps from colour0 to colour1 and the squared error of a BC1 encoding
+struct BC1Candidate {
+	uint16_t color0;
+	uint16_t color1;
+	alignas(32) float steps[16];
+	float error;
+};
+
+void evaluateBC1(const BlockChannels& block, const float e0[3], const float e1[3], BC1Candidate& candidate) {
+	candidate.color0 = packRGB565(e0);
+	candidate.color1 = packRGB565(e1);
+	float q0[3], q1[3];
+	unpackRGB565(candidate.color0, q0);
+	unpackRGB565(candidate.color1, q1);
+	selectSteps(block, 3, q0, q1, 4, candidate.steps);
+	candidate.error = 0;
+	for (unsigned int i = 0; i < 16; i++) {
+		const float w = candidate.steps[i] / 3;
+		for (unsigned int c = 0; c < 3; c++) {
+			const float difference = q0[c] + (q1[c] - q0[c]) * w - block.values[c][i];
+			candidate.error += difference * difference;
+		}
+	}
+}
+
+void encodeBC1(const uint8_t texels[64], uint8_t block[8]) {
+	BlockChannels channels;
+	loadChannels(texels, channels);
+	float e0[4], e1[4];
+	axisEndpoints(channels, 3, e0, e1);
+	BC1Candidate best;
+	evaluateBC1(channels, e0, e1, best);
+	if (refitEndpoints(channels, 3, best.steps, 4, e0, e1)) {
+		BC1Candidate refit;
+		evaluateBC1(channels, e0, e1, refit);
+		if (refit.error < best.error) best = refit;
+	}
+
+	// The 4 colour mode needs colour0 > colour1, the codes of the steps are 0: colour0, 1: colour1, 2: 2/3 colour0, 3: 1/3 colour0
+	static const uint32_t codes[4] = { 0, 2, 3, 1 };
+	uint16_t color0 = best.color0, color1 = best.color1;
+	const bool swapped = color0 < color1;
+	if (swapped) std::swap(color0, color1);
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		for (unsigned int i = 0; i < 16; i++) {
+			const unsigned int step = unsigned(best.steps[i]);
+			indices |= codes[swapped ? 3 - step : step] << (i * 2);
+		}
+	}
+	block[0] = uint8_t(color0);
+	block[1] = uint8_t(color0 >> 8);
+	block[2] = uint8_t(color1);
+	block[3] = uint8_t(color1 >> 8);
+	for (unsigned int i = 0; i < 4; i++) block[4 + i] = uint8_t(indices >> (i * 8));
+}
+
+//
+// BC4 and BC5
+//
+
+// Quantized endpoints, the steps from red0 to red1 and the squared error of a BC4 encoding
+struct BC4Candidate {
+	uint8_t red0;
+	uint8_t red1;
+	alignas(32) float steps[16];
+	float error;
+};
+
+void evaluateBC4(const BlockChannels& block, float e0, float e1, BC4Candidate& candidate) {
+	// The 8 value mode needs red0 > red1, so red0 is the larger endpoint and the steps run down from it
+	candidate.red0 = uint8_t(std::lround(std::max(e0, e1)));
+	candidate.red1 = uint8_t(std::lround(std::min(e0, e1)));
+	const float q0 = candidate.red0;
+	const float q1 = candidate.red1;
+	selectSteps(block, 1, &q0, &q1, 8, candidate.steps);
+	candidate.error = 0;
+	for (unsigned int i = 0; i < 16; i++) {
+		const float difference = q0 + (q1 - q0) * candidate.steps[i] / 7 - block.values[0][i];
+		candidate.error += difference * difference;
+	}
+}
+
+void encodeBC4(const uint8_t texels[64], unsigned int channel, uint8_t block[8]) {
+	BlockChannels channels;
+	for (unsigned int i = 0; i < 16; i++) {
+		channels.values[0][i] = texels[i * 4 + channel];
+	}
+	// With one channel the principal axis is the channel itself, the texels span from the maximum to the minimum
+	float e0 = *std::max_element(channels.values[0], channels.values[0] + 16);
+	float e1 = *std::min_element(channels.values[0], channels.values[0] + 16);
+	BC4Candidate best;
+	evaluateBC4(channels, e0, e1, best);
+	if (refitEndpoints(channels, 1, best.steps, 8, &e0, &e1)) {
+		BC4Candidate refit;
+		evaluateBC4(channels, e0, e1, refit);
+		if (refit.error < best.error) best = refit;
+	}
+
+	// Codes of the steps from red0: 0 is red0, 1 is red1 and 2 to 7 are the values in between
+	static const uint64_t codes[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+	uint64_t indices = 0;
+	if (best.red0 != best.red1) {
+		for (unsigned int i = 0; i < 16; i++) {
+			indices |= codes[unsigned(best.steps[i])] << (i * 3);
+		}
+	}
+	block[0] = best.red0;
+	block[1] = best.red1;
+	for (unsigned int i = 0; i < 6; i++) block[2 + i] = uint8_t(indices >> (i * 8));
+}
+
+void encodeBC5(const uint8_t texels[64], uint8_t block[16]) {
+	encodeBC4(texels, 0, block);
+	encodeBC4(texels, 1, block + 8);
+}
+
+//
+// BC7
+//
+
+// 7 bit endpoint with the shared p bit that brings it closest to the colour
+void quantizeBC7Endpoint(const float endpoint[4], uint32_t quantized[4], uint32_t& pBit) {
+	float bestError = INFINITY;
+	for (uint32_t p = 0; p < 2; p++) {
+		uint32_t candidate[4];
+		float error = 0;
+		for (unsigned int c = 0; c < 4; c++) {
+			candidate[c] = uint32_t(std::min(std::max(std::lround((endpoint[c] - p) / 2), 0l), 127l));
+			const float difference = float(candidate[c] * 2 + p) - endpoint[c];
+			error += difference * difference;
+		}
+		if (error < bestError) {
+			bestError = error;
+			pBit = p;
+			std::copy(candidate, candidate + 4, quantized);
+		}
+	}
+}
+
+struct BC7Candidate {
+	uint32_t endpoints[2][4];
+	uint32_t pBits[2];
+	alignas(32) float steps[16];
+	float error;
+};
+
+void evaluateBC7(const BlockChannels& block, const float e0[4], const float e1[4], BC7Candidate& candidate) {
+	quantizeBC7Endpoint(e0, candidate.endpoints[0], candidate.pBits[0]);
+	quantizeBC7Endpoint(e1, candidate.endpoints[1], candidate.pBits[1]);
+	float q0[4], q1[4];
+	for (unsigned int c = 0; c < 4; c++) {
+		q0[c] = float(candidate.endpoints[0][c] * 2 + candidate.pBits[0]);
+		q1[c] = float(candidate.endpoints[1][c] * 2 + candidate.pBits[1]);
+	}
+	// The weights are close enough to even steps for the projection to find the nearest one
+	selectSteps(block, 4, q0, q1, 16, candidate.steps);
+	candidate.error = 0;
+	for (unsigned int i = 0; i < 16; i++) {
+		const int w = BC7_WEIGHTS[unsigned(candidate.steps[i])];
+		for (unsigned int c = 0; c < 4; c++) {
+			const float decoded = float(((64 - w) * int(q0[c]) + w * int(q1[c]) + 32) >> 6);
+			const float difference = decoded - block.values[c][i];
+			candidate.error += difference * difference;
+		}
+	}
+}
+
+void encodeBC7(const uint8_t texels[64], uint8_t block[16]) {
+	BlockChannels channels;
+	loadChannels(texels, channels);
+	float e0[4], e1[4];
+	axisEndpoints(channels, 4, e0, e1);
+	BC7Candidate best;
+	evaluateBC7(channels, e0, e1, best);
+	if (refitEndpoints(channels, 4, best.steps, 16, e0, e1)) {
+		BC7Candidate refit;
+		evaluateBC7(channels, e0, e1, refit);
+		if (refit.error < best.error) best = refit;
+	}
+
+	// The top bit of the first index is implied to be 0, flip the line when the first texel is past the middle
+	unsigned int first = 0, second = 1;
+	const bool flipped = best.steps[0] >= 8;
+	if (flipped) std::swap(first, second);
+
+	memset(block, 0, 16);
+	BitWriter bits = { block, 0 };
+	// Mode 6 is a 1 in bit 6
+	bits.write(1 << 6, 7);
+	for (unsigned int c = 0; c < 4; c++) {
+		bits.write(best.endpoints[first][c], 7);
+		bits.write(best.endpoints[second][c], 7);
+	}
+	bits.write(best.pBits[first], 1);
+	bits.write(best.pBits[second], 1);
+	for (unsigned int i = 0; i < 16; i++) {
+		const unsigned int step = unsigned(best.steps[i]);
+		bits.write(flipped ? 15 - step : step, i == 0 ? 3 : 4);
+	}
+}
+
+void compressImage(const PNGImage& image, TextureFileFormat format, ThreadPool& pool, std::vector<uint8_t>& blocks) {
+	assert(isBlockCompressed(format) && "Format is not block compressed");
+	const unsigned int blocksWide = (image.width + 3) / 4;
+	const unsigned int blocksHigh = (image.height + 3) / 4;
+	const uint32_t blockSize = textureFileElementSize(format);
+	blocks.resize(size_t(blocksWide) * blocksHigh * blockSize);
+
+	pool.parallelFor(blocksHigh, [&](unsigned int row) {
+		uint8_t texels[64];
+		for (unsigned int column = 0; column < blocksWide; column++) {
+			for (unsigned int y = 0; y < 4; y++) {
+				const unsigned int sourceY = std::min(row * 4 + y, image.height - 1);
+				for (unsigned int x = 0; x < 4; x++) {
+					const unsigned int sourceX = std::min(column * 4 + x, image.width - 1);
+					memcpy(&texels[(y * 4 + x) * 4], &image.pixels[(sourceY * image.width + sourceX) * 4], 4);
+				}
+			}
+			uint8_t* block = &blocks[(size_t(row) * blocksWide + column) * blockSize];
+			switch (format) {
+			case TEXTURE_FILE_BC1: encodeBC1(texels, block); break;
+			case TEXTURE_FILE_BC4: encodeBC4(texels, 0, block); break;
+			case TEXTURE_FILE_BC5: encodeBC5(texels, block); break;
+			case TEXTURE_FILE_BC7: encodeBC7(texels, block); break;
+			default: break;
+			}
+		}
+	});
+}
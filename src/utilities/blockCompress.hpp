@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "imageLoader.hpp"
+#include "textureFile.hpp"
+
+class ThreadPool;
+
+// Block compression encoders for cooked textures. Every encoder takes one 4x4 block of RGBA texels,
+// row by row, and writes the block as the GPU reads it. Endpoints start where the principal axis of the
+// texels enters and leaves them, for the one channel of BC4 that is its minimum and maximum. They are
+// refined by one least squares fit, the per texel projections run on the vector instructions of simd.hpp.
+
+// Opaque 4 colour mode, 8 bytes
+void encodeBC1(const uint8_t texels[64], uint8_t block[8]);
+// One channel of the texels with 8 interpolated values, 8 bytes
+void encodeBC4(const uint8_t texels[64], unsigned int channel, uint8_t block[8]);
+// Red and green as two BC4 blocks, 16 bytes
+void encodeBC5(const uint8_t texels[64], uint8_t block[16]);
+// Mode 6 only: one RGBA line with 16 steps, 16 bytes
+void encodeBC7(const uint8_t texels[64], uint8_t block[16]);
+
+// Compress an RGBA image into one of the block compressed formats, one block row per task.
+// Blocks hanging over the edge of the image repeat its last row and column
+void compressImage(const PNGImage& image, TextureFileFormat format, ThreadPool& pool, std::vector<uint8_t>& blocks);
@@ -0,0 +1,55 @@
+#include "bounds.hpp"
+#include <cmath>
+
+Bounds computeBounds(const Mesh& mesh) {
+	Bounds bounds;
+	if (mesh.vertices.empty()) {
+		return bounds;
+	}
+
+	bounds.box.min = mesh.vertices[0];
+	bounds.box.max = mesh.vertices[0];
+	for (const glm::vec3& vertex : mesh.vertices) {
+		bounds.box.min = glm::min(bounds.box.min, vertex);
+		bounds.box.max = glm::max(bounds.box.max, vertex);
+	}
+
+	bounds.sphere.center = bounds.box.center();
+	float radius2 = 0;
+	for (const glm::vec3& vertex : mesh.vertices) {
+		glm::vec3 d = vertex - bounds.sphere.center;
+		radius2 = std::max(radius2, glm::dot(d, d));
+	}
+	bounds.sphere.radius = std::sqrt(radius2);
+
+	return bounds;
+}
+
+// Transform the center, then project the extents on each world axis (Arvo's method)
+AABB transformAABB(const glm::mat4& transform, const AABB& box) {
+	const glm::vec3 center = glm::vec3(transform * glm::vec4(box.center(), 1.0f));
+	const glm::vec3 extents = box.extents();
+
+	glm::vec3 worldExtents;
+	for (int row = 0; row < 3; row++) {
+		worldExtents[row] = std::fabs(transform[0][row]) * extents.x
+			+ std::fabs(transform[1][row]) * extents.y
+			+ std::fabs(transform[2][row]) * extents.z;
+	}
+
+	AABB result;
+	result.min = center - worldExtents;
+	result.max = center + worldExtents;
+	return result;
+}
+
+BoundingSphere transformSphere(const glm::mat4& transform, const BoundingSphere& sphere) {
+	const float scale2 = std::max(glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+		std::max(glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+			glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2]))));
+
+	BoundingSphere result;
+	result.center = glm::vec3(transform * glm::vec4(sphere.center, 1.0f));
+	result.radius = sphere.radius * std::sqrt(scale2);
+	return result;
+}
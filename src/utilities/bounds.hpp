@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+
+#include "mesh.h"
+
+// Axis aligned bounding box
+struct AABB {
+	glm::vec3 min = glm::vec3(0, 0, 0);
+	glm::vec3 max = glm::vec3(0, 0, 0);
+
+	glm::vec3 center() const { return (min + max) * 0.5f; }
+	glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+	// Half the surface area, the constant factor doesn't matter when comparing tree costs
+	float perimeter() const {
+		glm::vec3 d = max - min;
+		return d.x * d.y + d.y * d.z + d.z * d.x;
+	}
+
+	bool contains(const AABB& other) const {
+		return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+			&& other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+	}
+
+	bool overlaps(const AABB& other) const {
+		return min.x <= other.max.x && other.min.x <= max.x
+			&& min.y <= other.max.y && other.min.y <= max.y
+			&& min.z <= other.max.z && other.min.z <= max.z;
+	}
+};
+
+inline AABB merge(const AABB& a, const AABB& b) {
+	AABB result;
+	result.min = glm::min(a.min, b.min);
+	result.max = glm::max(a.max, b.max);
+	return result;
+}
+
+struct BoundingSphere {
+	glm::vec3 center = glm::vec3(0, 0, 0);
+	float radius = 0;
+};
+
+// Squared distance from `point` to the closest point of `box`, 0 when the point is inside
+inline float distance2(const AABB& box, const glm::vec3& point) {
+	const glm::vec3 d = glm::max(glm::max(box.min - point, point - box.max), glm::vec3(0));
+	return glm::dot(d, d);
+}
+
+inline bool overlaps(const AABB& box, const BoundingSphere& sphere) {
+	return distance2(box, sphere.center) <= sphere.radius * sphere.radius;
+}
+
+// Distances along the ray are in units of the direction's length
+struct Ray {
+	glm::vec3 origin = glm::vec3(0, 0, 0);
+	glm::vec3 direction = glm::vec3(0, 0, -1);
+	float maxDistance = 1e30f;
+};
+
+// Slab test with a precomputed 1 / direction. Returns the distances where the ray's line enters and
+// leaves the box, the ray misses when enter > leave, leave < 0 or enter > maxDistance
+inline void intersectSlabs(const AABB& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float& enter, float& leave) {
+	const glm::vec3 t1 = (box.min - origin) * inverseDirection;
+	const glm::vec3 t2 = (box.max - origin) * inverseDirection;
+	const glm::vec3 closer = glm::min(t1, t2);
+	const glm::vec3 further = glm::max(t1, t2);
+	enter = std::max(std::max(closer.x, closer.y), closer.z);
+	leave = std::min(std::min(further.x, further.y), further.z);
+}
+
+// Local space bounding volumes of a mesh
+struct Bounds {
+	AABB box;
+	BoundingSphere sphere;
+};
+
+// Box around every vertex, and the sphere around the box center that encloses every vertex,
+// which is tighter than the sphere around the box for round meshes
+Bounds computeBounds(const Mesh& mesh);
+
+// Box enclosing `box` after it has been transformed by `transform`
+AABB transformAABB(const glm::mat4& transform, const AABB& box);
+
+// Sphere enclosing `sphere` after it has been transformed by `transform`, the radius is scaled by the largest axis scale
+BoundingSphere transformSphere(const glm::mat4& transform, const BoundingSphere& sphere);
@@ -0,0 +1,222 @@
+#include "dynamicAABBTree.hpp"
+#include <algorithm>
+#include <cassert>
+
+// Fat boxes are grown by a fraction of their size, so large and small objects both get room to move
+const float FAT_MARGIN_FRACTION = 0.1f;
+const float MIN_FAT_MARGIN = 0.1f;
+
+AABB fatten(const AABB& box) {
+	const glm::vec3 margin = box.extents() * FAT_MARGIN_FRACTION + glm::vec3(MIN_FAT_MARGIN);
+	AABB fat;
+	fat.min = box.min - margin;
+	fat.max = box.max + margin;
+	return fat;
+}
+
+int DynamicAABBTree::allocateNode() {
+	if (freeList == NULL_NODE) {
+		nodes.emplace_back();
+		nodes.back().height = 0;
+		return nodes.size() - 1;
+	}
+
+	const int node = freeList;
+	freeList = nodes[node].parent;
+	nodes[node] = TreeNode();
+	nodes[node].height = 0;
+	return node;
+}
+
+void DynamicAABBTree::freeNode(int node) {
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+int DynamicAABBTree::createProxy(const AABB& box, uint32_t userData) {
+	const int proxy = allocateNode();
+	nodes[proxy].box = fatten(box);
+	nodes[proxy].userData = userData;
+	insertLeaf(proxy);
+	leafCount++;
+	return proxy;
+}
+
+void DynamicAABBTree::destroyProxy(int proxy) {
+	assert(nodes[proxy].isLeaf() && nodes[proxy].height == 0 && "Not a proxy");
+	removeLeaf(proxy);
+	freeNode(proxy);
+	leafCount--;
+}
+
+bool DynamicAABBTree::moveProxy(int proxy, const AABB& box) {
+	const AABB fat = fatten(box);
+	const AABB& current = nodes[proxy].box;
+	// Also reinsert when the object shrunk a lot, otherwise its fat box keeps matching far too much
+	if (current.contains(box) && current.perimeter() <= 4.0f * fat.perimeter()) {
+		return false;
+	}
+
+	removeLeaf(proxy);
+	nodes[proxy].box = fat;
+	insertLeaf(proxy);
+	return true;
+}
+
+void DynamicAABBTree::insertLeaf(int leaf) {
+	if (root == NULL_NODE) {
+		root = leaf;
+		nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	// Walk down to the sibling with the lowest surface area cost
+	const AABB leafBox = nodes[leaf].box;
+	int index = root;
+	while (!nodes[index].isLeaf()) {
+		const TreeNode& node = nodes[index];
+		const float area = node.box.perimeter();
+		const float combinedArea = merge(node.box, leafBox).perimeter();
+
+		// Cost of making a new parent for this node and the leaf
+		const float cost = 2.0f * combinedArea;
+		// Minimum cost of pushing the leaf further down, every ancestor grows by the same amount
+		const float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		const int children[2] = { node.child1, node.child2 };
+		for (int i = 0; i < 2; i++) {
+			const TreeNode& child = nodes[children[i]];
+			const float grownArea = merge(child.box, leafBox).perimeter();
+			childCosts[i] = (child.isLeaf() ? grownArea : grownArea - child.box.perimeter()) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1]) {
+			break;
+		}
+		index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+	}
+	const int sibling = index;
+
+	// allocateNode can grow the node array, so no references are held across it
+	const int oldParent = nodes[sibling].parent;
+	const int newParent = allocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].box = merge(leafBox, nodes[sibling].box);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if (oldParent == NULL_NODE) {
+		root = newParent;
+	}
+	else if (nodes[oldParent].child1 == sibling) {
+		nodes[oldParent].child1 = newParent;
+	}
+	else {
+		nodes[oldParent].child2 = newParent;
+	}
+
+	refitAncestors(newParent);
+}
+
+void DynamicAABBTree::removeLeaf(int leaf) {
+	if (leaf == root) {
+		root = NULL_NODE;
+		return;
+	}
+
+	const int parent = nodes[leaf].parent;
+	const int grandParent = nodes[parent].parent;
+	const int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	// The sibling takes the place of the parent
+	nodes[sibling].parent = grandParent;
+	freeNode(parent);
+	if (grandParent == NULL_NODE) {
+		root = sibling;
+		return;
+	}
+
+	if (nodes[grandParent].child1 == parent) {
+		nodes[grandParent].child1 = sibling;
+	}
+	else {
+		nodes[grandParent].child2 = sibling;
+	}
+	refitAncestors(grandParent);
+}
+
+void DynamicAABBTree::refitAncestors(int index) {
+	while (index != NULL_NODE) {
+		index = balance(index);
+
+		TreeNode& node = nodes[index];
+		const TreeNode& child1 = nodes[node.child1];
+		const TreeNode& child2 = nodes[node.child2];
+		node.height = 1 + std::max(child1.height, child2.height);
+		node.box = merge(child1.box, child2.box);
+
+		index = node.parent;
+	}
+}
+
+// Rotate the taller child of `a` up if the children heights differ by more than one.
+// Returns the node now at the position of `a`.
+int DynamicAABBTree::balance(int a) {
+	TreeNode& A = nodes[a];
+	if (A.isLeaf() || A.height < 2) {
+		return a;
+	}
+
+	const int b = A.child1;
+	const int c = A.child2;
+	const int difference = nodes[c].height - nodes[b].height;
+	if (difference >= -1 && difference <= 1) {
+		return a;
+	}
+
+	// `up` is the taller child that takes the place of a, `other` stays below a
+	const int up = difference > 1 ? c : b;
+	const int other = difference > 1 ? b : c;
+	TreeNode& U = nodes[up];
+	const TreeNode& O = nodes[other];
+
+	U.parent = A.parent;
+	A.parent = up;
+	if (U.parent == NULL_NODE) {
+		root = up;
+	}
+	else if (nodes[U.parent].child1 == a) {
+		nodes[U.parent].child1 = up;
+	}
+	else {
+		nodes[U.parent].child2 = up;
+	}
+
+	// The taller grandchild stays under `up`, the shorter one moves under a in place of `up`
+	const int f = U.child1;
+	const int g = U.child2;
+	const int keep = nodes[f].height > nodes[g].height ? f : g;
+	const int move = keep == f ? g : f;
+
+	U.child1 = a;
+	U.child2 = keep;
+	if (up == c) {
+		A.child2 = move;
+	}
+	else {
+		A.child1 = move;
+	}
+	nodes[move].parent = a;
+
+	A.box = merge(O.box, nodes[move].box);
+	A.height = 1 + std::max(O.height, nodes[move].height);
+	U.box = merge(A.box, nodes[keep].box);
+	U.height = 1 + std::max(A.height, nodes[keep].height);
+
+	return up;
+}
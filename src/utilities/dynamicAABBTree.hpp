@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "bounds.hpp"
+#include "frustum.hpp"
+
+// Bounding volume hierarchy over a changing set of boxes, in the style of Box2D's b2DynamicTree.
+// Leaves store a "fat" box that is a bit larger than the real one, so small movements only
+// update the stored box and the tree is only changed when a box leaves its fat box.
+// Leaves are inserted next to the sibling that grows the tree the least and the tree is kept
+// balanced with rotations, so queries stay logarithmic no matter the insertion order.
+class DynamicAABBTree {
+public:
+	static const int NULL_NODE = -1;
+
+	// Returns the proxy id of the new leaf, userData is handed back by the queries
+	int createProxy(const AABB& box, uint32_t userData);
+	void destroyProxy(int proxy);
+	// Returns true when the proxy had to be reinserted because it left its fat box
+	bool moveProxy(int proxy, const AABB& box);
+
+	uint32_t getUserData(int proxy) const { return nodes[proxy].userData; }
+	const AABB& getFatAABB(int proxy) const { return nodes[proxy].box; }
+	unsigned int proxyCount() const { return leafCount; }
+	int height() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+
+	// Calls visit(proxy, fullyInside) for every leaf whose fat box is not outside the frustum.
+	// Subtrees completely inside the frustum are reported without testing their leaves.
+	// Returns the number of tree nodes tested against the frustum.
+	template <class Visit> unsigned int queryFrustum(const Frustum& frustum, Visit visit) const;
+	// Calls visit(proxy) for every leaf whose fat box overlaps `box`
+	template <class Visit> void queryOverlap(const AABB& box, Visit visit) const;
+	// Calls visit(proxy, maxDistance) for every leaf whose fat box the ray passes through before maxDistance.
+	// visit returns the new maxDistance, so returning the distance of a hit skips everything behind it
+	template <class Visit> void queryRay(const Ray& ray, Visit visit) const;
+	// Calls visit(proxy, maxDistance2) for leaves in order of the squared distance from `point` to their fat box,
+	// until that distance is larger than maxDistance2. visit returns the new maxDistance2,
+	// a k nearest search returns the distance of the k-th closest leaf found so far
+	template <class Visit> void queryNearest(const glm::vec3& point, float maxDistance2, Visit visit) const;
+
+private:
+	struct TreeNode {
+		AABB box;
+		// Parent while in the tree, next free node while on the free list
+		int parent = NULL_NODE;
+		int child1 = NULL_NODE;
+		int child2 = NULL_NODE;
+		// 0 for leaves, -1 for free nodes
+		int height = -1;
+		uint32_t userData = 0;
+
+		bool isLeaf() const { return child1 == NULL_NODE; }
+	};
+
+	int allocateNode();
+	void freeNode(int node);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	int balance(int node);
+	// Recompute the box and height of every ancestor of `node`, balancing on the way up
+	void refitAncestors(int node);
+	template <class Visit> void visitLeaves(int node, Visit& visit) const;
+
+	std::vector<TreeNode> nodes;
+	int root = NULL_NODE;
+	int freeList = NULL_NODE;
+	unsigned int leafCount = 0;
+	// Traversal stack and nearest first queue, kept to avoid allocating on every query
+	mutable std::vector<int> stack;
+	mutable std::vector<std::pair<float, int>> queue;
+};
+
+template <class Visit> void DynamicAABBTree::visitLeaves(int node, Visit& visit) const {
+	const size_t base = stack.size();
+	stack.push_back(node);
+	while (stack.size() > base) {
+		const int index = stack.back();
+		stack.pop_back();
+		const TreeNode& current = nodes[index];
+		if (current.isLeaf()) {
+			visit(index, true);
+		}
+		else {
+			stack.push_back(current.child1);
+			stack.push_back(current.child2);
+		}
+	}
+}
+
+template <class Visit> unsigned int DynamicAABBTree::queryFrustum(const Frustum& frustum, Visit visit) const {
+	if (root == NULL_NODE) return 0;
+
+	unsigned int tested = 0;
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty()) {
+		const int index = stack.back();
+		stack.pop_back();
+		const TreeNode& node = nodes[index];
+
+		tested++;
+		const FrustumTest result = testAABB(frustum, node.box);
+		if (result == FRUSTUM_OUTSIDE) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			visit(index, result == FRUSTUM_INSIDE);
+		}
+		else if (result == FRUSTUM_INSIDE) {
+			visitLeaves(index, visit);
+		}
+		else {
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+	return tested;
+}
+
+template <class Visit> void DynamicAABBTree::queryOverlap(const AABB& box, Visit visit) const {
+	if (root == NULL_NODE) return;
+
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty()) {
+		const int index = stack.back();
+		stack.pop_back();
+		const TreeNode& node = nodes[index];
+		if (!node.box.overlaps(box)) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			visit(index);
+		}
+		else {
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+}
+
+template <class Visit> void DynamicAABBTree::queryRay(const Ray& ray, Visit visit) const {
+	if (root == NULL_NODE) return;
+
+	const glm::vec3 inverseDirection = 1.0f / ray.direction;
+	float maxDistance = ray.maxDistance;
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty()) {
+		const int index = stack.back();
+		stack.pop_back();
+		const TreeNode& node = nodes[index];
+
+		float enter, leave;
+		intersectSlabs(node.box, ray.origin, inverseDirection, enter, leave);
+		if (enter > leave || leave < 0 || enter > maxDistance) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			maxDistance = visit(index, maxDistance);
+		}
+		else {
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+}
+
+template <class Visit> void DynamicAABBTree::queryNearest(const glm::vec3& point, float maxDistance2, Visit visit) const {
+	if (root == NULL_NODE) return;
+
+	// Min heap on the distance to the box
+	const std::greater<std::pair<float, int>> closer;
+	queue.clear();
+	queue.push_back({ distance2(nodes[root].box, point), root });
+	while (!queue.empty()) {
+		std::pop_heap(queue.begin(), queue.end(), closer);
+		const std::pair<float, int> entry = queue.back();
+		queue.pop_back();
+		// Every box still in the queue is at least this far away
+		if (entry.first > maxDistance2) {
+			break;
+		}
+
+		const TreeNode& node = nodes[entry.second];
+		if (node.isLeaf()) {
+			maxDistance2 = visit(entry.second, maxDistance2);
+			continue;
+		}
+		for (int child : { node.child1, node.child2 }) {
+			const float childDistance2 = distance2(nodes[child].box, point);
+			if (childDistance2 <= maxDistance2) {
+				queue.push_back({ childDistance2, child });
+				std::push_heap(queue.begin(), queue.end(), closer);
+			}
+		}
+	}
+}
@@ -0,0 +1,83 @@
+#include "frustum.hpp"
+#include "simd.hpp"
+#include <cfloat>
+#include <cmath>
+
+Frustum extractFrustum(const glm::mat4& viewProjection) {
+	// glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	const glm::mat4& m = viewProjection;
+	const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	// Left, right, bottom, top, near, far
+	const glm::vec4 planes[Frustum::PLANES] = {
+		row3 + row0,
+		row3 - row0,
+		row3 + row1,
+		row3 - row1,
+		row3 + row2,
+		row3 - row2,
+	};
+
+	Frustum frustum;
+	for (int i = 0; i < Frustum::PLANES; i++) {
+		const float invLength = 1.0f / glm::length(glm::vec3(planes[i]));
+		frustum.nx[i] = planes[i].x * invLength;
+		frustum.ny[i] = planes[i].y * invLength;
+		frustum.nz[i] = planes[i].z * invLength;
+		frustum.d[i] = planes[i].w * invLength;
+	}
+	for (int i = Frustum::PLANES; i < Frustum::LANES; i++) {
+		frustum.nx[i] = 0;
+		frustum.ny[i] = 0;
+		frustum.nz[i] = 0;
+		frustum.d[i] = FLT_MAX;
+	}
+	return frustum;
+}
+
+// Shared by both tests: a volume with the given center is outside a plane when its signed
+// distance is below -radius and crosses it when the distance is below radius.
+// `radius` returns the projected radius of the volume on the plane normal for a batch of planes
+template <class Radius> inline FrustumTest testVolume(const Frustum& frustum, const glm::vec3& center, Radius radius) {
+	const vfloat cx = vset(center.x);
+	const vfloat cy = vset(center.y);
+	const vfloat cz = vset(center.z);
+
+	int intersecting = 0;
+	for (int lane = 0; lane < Frustum::LANES; lane += WIDTH) {
+		const vfloat nx = vload(frustum.nx + lane);
+		const vfloat ny = vload(frustum.ny + lane);
+		const vfloat nz = vload(frustum.nz + lane);
+
+		const vfloat distance = vadd(vadd(vadd(vmul(nx, cx), vmul(ny, cy)), vmul(nz, cz)), vload(frustum.d + lane));
+		const vfloat r = radius(nx, ny, nz);
+
+		if (vlessMask(vadd(distance, r), vset(0.0f)) != 0) {
+			return FRUSTUM_OUTSIDE;
+		}
+		intersecting |= vlessMask(vsub(distance, r), vset(0.0f));
+	}
+	return intersecting != 0 ? FRUSTUM_INTERSECTS : FRUSTUM_INSIDE;
+}
+
+FrustumTest testAABB(const Frustum& frustum, const AABB& box) {
+	const glm::vec3 extents = box.extents();
+	const vfloat ex = vset(extents.x);
+	const vfloat ey = vset(extents.y);
+	const vfloat ez = vset(extents.z);
+
+	// Projected radius of the box is dot(|normal|, extents)
+	return testVolume(frustum, box.center(), [&](vfloat nx, vfloat ny, vfloat nz) {
+		return vadd(vadd(vmul(vabs(nx), ex), vmul(vabs(ny), ey)), vmul(vabs(nz), ez));
+	});
+}
+
+FrustumTest testSphere(const Frustum& frustum, const BoundingSphere& sphere) {
+	const vfloat radius = vset(sphere.radius);
+	return testVolume(frustum, sphere.center, [&](vfloat, vfloat, vfloat) {
+		return radius;
+	});
+}
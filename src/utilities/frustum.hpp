@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "bounds.hpp"
+
+enum FrustumTest {
+	FRUSTUM_OUTSIDE,
+	FRUSTUM_INTERSECTS,
+	FRUSTUM_INSIDE,
+};
+
+// The six clip planes of a view projection, stored plane-per-lane so one box is tested
+// against several planes per instruction. Planes point inwards, a point p is inside when
+// dot(normal, p) + d >= 0 for every plane. The two spare lanes hold planes that pass everything.
+struct Frustum {
+	static const int PLANES = 6;
+	static const int LANES = 8;
+
+	alignas(32) float nx[LANES];
+	alignas(32) float ny[LANES];
+	alignas(32) float nz[LANES];
+	alignas(32) float d[LANES];
+};
+
+// Gribb-Hartmann plane extraction, the planes are normalized so sphere radii can be compared with the distances
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+FrustumTest testAABB(const Frustum& frustum, const AABB& box);
+FrustumTest testSphere(const Frustum& frustum, const BoundingSphere& sphere);
@@ -0,0 +1,230 @@
+#include "geometryHeap.hpp"
+#include <algorithm>
+#include <cassert>
+
+void RangeAllocator::reset(uint32_t newCapacity, uint32_t used) {
+	capacity = newCapacity;
+	freeSpace = newCapacity - used;
+	freeBlocks.clear();
+	if (freeSpace > 0) {
+		freeBlocks[used] = freeSpace;
+	}
+}
+
+uint32_t RangeAllocator::allocate(uint32_t size) {
+	auto best = freeBlocks.end();
+	for (auto block = freeBlocks.begin(); block != freeBlocks.end(); ++block) {
+		if (block->second >= size && (best == freeBlocks.end() || block->second < best->second)) {
+			best = block;
+			if (block->second == size) break;
+		}
+	}
+	if (best == freeBlocks.end()) {
+		return INVALID;
+	}
+
+	const uint32_t offset = best->first;
+	const uint32_t remaining = best->second - size;
+	freeBlocks.erase(best);
+	if (remaining > 0) {
+		freeBlocks[offset + size] = remaining;
+	}
+	freeSpace -= size;
+	return offset;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t size) {
+	freeSpace += size;
+	auto next = freeBlocks.lower_bound(offset);
+
+	// Merge with the block ending at offset
+	if (next != freeBlocks.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset) {
+			offset = previous->first;
+			size += previous->second;
+			freeBlocks.erase(previous);
+		}
+	}
+	// Merge with the block starting at the end
+	if (next != freeBlocks.end() && offset + size == next->first) {
+		size += next->second;
+		freeBlocks.erase(next);
+	}
+
+	freeBlocks[offset] = size;
+}
+
+uint32_t RangeAllocator::largestFreeBlock() const {
+	uint32_t largest = 0;
+	for (const auto& block : freeBlocks) {
+		largest = std::max(largest, block.second);
+	}
+	return largest;
+}
+
+const uint32_t INITIAL_HEAP_VERTICES = 1 << 16;
+const uint32_t INITIAL_HEAP_INDICES = 1 << 18;
+// Indices relative to a mesh of up to this many vertices fit in 16 bits
+const uint32_t MAX_SHORT_INDEX_VERTICES = 1 << 16;
+
+void GeometryHeap::writeIndices(uint32_t offset, const std::vector<unsigned int>& data) {
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	if (wideIndices) {
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset * sizeof(GLuint), data.size() * sizeof(GLuint), data.data());
+	}
+	else {
+		std::vector<GLushort> narrow(data.begin(), data.end());
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset * sizeof(GLushort), narrow.size() * sizeof(GLushort), narrow.data());
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+int GeometryHeap::upload(const Mesh& mesh, const std::vector<MeshLOD>& lods) {
+	assert(lods.size() <= MAX_MESH_LODS && "Too many levels of detail");
+	const uint32_t vertexCount = mesh.vertices.size();
+	uint32_t indexCount = lods.empty() ? mesh.indices.size() : 0;
+	for (const MeshLOD& lod : lods) {
+		indexCount += lod.indices.size();
+	}
+	assert(vertexCount > 0 && indexCount > 0 && "Empty meshes can't be placed in the heap");
+
+	const bool needsWideIndices = !wideIndices && vertexCount > MAX_SHORT_INDEX_VERTICES;
+	uint32_t vertexOffset = needsWideIndices ? RangeAllocator::INVALID : vertices.allocate(vertexCount);
+	uint32_t indexOffset = needsWideIndices ? RangeAllocator::INVALID : indices.allocate(indexCount);
+	if (vertexOffset == RangeAllocator::INVALID || indexOffset == RangeAllocator::INVALID) {
+		// The reallocation moves every mesh, so give back the half that did fit first
+		if (vertexOffset != RangeAllocator::INVALID) vertices.free(vertexOffset, vertexCount);
+		if (indexOffset != RangeAllocator::INVALID) indices.free(indexOffset, indexCount);
+
+		// Compacting is enough when the free space adds up to the mesh, otherwise grow
+		uint32_t vertexCapacity = vertices.capacity;
+		uint32_t indexCapacity = indices.capacity;
+		if (vertices.freeSpace < vertexCount) {
+			vertexCapacity = std::max(std::max(vertexCapacity * 2, vertexCapacity + vertexCount), INITIAL_HEAP_VERTICES);
+		}
+		if (indices.freeSpace < indexCount) {
+			indexCapacity = std::max(std::max(indexCapacity * 2, indexCapacity + indexCount), INITIAL_HEAP_INDICES);
+		}
+		reallocate(vertexCapacity, indexCapacity, wideIndices || needsWideIndices);
+
+		vertexOffset = vertices.allocate(vertexCount);
+		indexOffset = indices.allocate(indexCount);
+	}
+
+	const std::vector<PackedVertex> packed = packVertices(mesh);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, vertexOffset * sizeof(PackedVertex), vertexCount * sizeof(PackedVertex), packed.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	// Indices stay relative to the mesh, the draw adds vertexOffset as the base vertex
+	HeapMesh entry = { vertexOffset, vertexCount, indexOffset, indexCount, computeBounds(mesh), {}, {}, 0, true };
+	if (lods.empty()) {
+		writeIndices(indexOffset, mesh.indices);
+		entry.lods[0] = { 0, indexCount };
+		entry.lodCount = 1;
+	}
+	uint32_t lodOffset = 0;
+	for (const MeshLOD& lod : lods) {
+		const uint32_t lodIndexCount = lod.indices.size();
+		writeIndices(indexOffset + lodOffset, lod.indices);
+		entry.lods[entry.lodCount] = { lodOffset, lodIndexCount };
+		entry.lodErrors[entry.lodCount++] = lod.error;
+		lodOffset += lodIndexCount;
+	}
+
+	int meshID;
+	if (freeMeshIDs.empty()) {
+		meshID = meshes.size();
+		meshes.emplace_back();
+	}
+	else {
+		meshID = freeMeshIDs.back();
+		freeMeshIDs.pop_back();
+	}
+	meshes[meshID] = entry;
+	return meshID;
+}
+
+void GeometryHeap::release(int meshID) {
+	HeapMesh& mesh = meshes[meshID];
+	assert(mesh.live && "Mesh was already released");
+	vertices.free(mesh.vertexOffset, mesh.vertexCount);
+	indices.free(mesh.indexOffset, mesh.indexCount);
+	mesh.live = false;
+	freeMeshIDs.push_back(meshID);
+}
+
+void GeometryHeap::compact() {
+	reallocate(vertices.capacity, indices.capacity, wideIndices);
+}
+
+void GeometryHeap::reallocate(uint32_t vertexCapacity, uint32_t indexCapacity, bool newWideIndices) {
+	const GLsizeiptr oldIndexSize = indexSize();
+	const GLsizeiptr newIndexSize = newWideIndices ? sizeof(GLuint) : sizeof(GLushort);
+	GLuint newVertexBuffer;
+	GLuint newIndexBuffer;
+	glGenBuffers(1, &newVertexBuffer);
+	glGenBuffers(1, &newIndexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newVertexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * sizeof(PackedVertex), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newIndexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * newIndexSize, nullptr, GL_STATIC_DRAW);
+
+	// Copy the live meshes back to back, in their current order so neighbours stay neighbours
+	std::vector<HeapMesh*> live;
+	for (HeapMesh& mesh : meshes) {
+		if (mesh.live) live.push_back(&mesh);
+	}
+	std::sort(live.begin(), live.end(), [](const HeapMesh* a, const HeapMesh* b) { return a->vertexOffset < b->vertexOffset; });
+
+	uint32_t vertexEnd = 0;
+	uint32_t indexEnd = 0;
+	for (HeapMesh* mesh : live) {
+		glBindBuffer(GL_COPY_READ_BUFFER, vertexBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, newVertexBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			mesh->vertexOffset * sizeof(PackedVertex), vertexEnd * sizeof(PackedVertex), mesh->vertexCount * sizeof(PackedVertex));
+
+		glBindBuffer(GL_COPY_READ_BUFFER, indexBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, newIndexBuffer);
+		if (newIndexSize == oldIndexSize) {
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				mesh->indexOffset * oldIndexSize, indexEnd * newIndexSize, mesh->indexCount * newIndexSize);
+		}
+		else {
+			// Widening only happens once, reading the indices back is simpler than a compute pass
+			std::vector<GLushort> narrow(mesh->indexCount);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, mesh->indexOffset * oldIndexSize, mesh->indexCount * oldIndexSize, narrow.data());
+			std::vector<GLuint> wide(narrow.begin(), narrow.end());
+			glBufferSubData(GL_COPY_WRITE_BUFFER, indexEnd * newIndexSize, mesh->indexCount * newIndexSize, wide.data());
+		}
+
+		mesh->vertexOffset = vertexEnd;
+		mesh->indexOffset = indexEnd;
+		vertexEnd += mesh->vertexCount;
+		indexEnd += mesh->indexCount;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (vao != 0) {
+		glDeleteBuffers(1, &vertexBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+	}
+	else {
+		glGenVertexArrays(1, &vao);
+	}
+	vertexBuffer = newVertexBuffer;
+	indexBuffer = newIndexBuffer;
+	wideIndices = newWideIndices;
+	vertices.reset(vertexCapacity, vertexEnd);
+	indices.reset(indexCapacity, indexEnd);
+
+	// Point the VAO at the new buffers
+	glBindVertexArray(vao);
+	applyVertexLayout(PACKED_VERTEX_LAYOUT, vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
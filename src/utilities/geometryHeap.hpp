@@ -0,0 +1,108 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "mesh.h"
+#include "bounds.hpp"
+#include "meshSimplify.hpp"
+#include "vertexFormat.hpp"
+
+// Offset allocator over [0, capacity). Free space is kept as a list of blocks ordered by offset,
+// freeing a block merges it with its free neighbours so the list never holds two adjacent blocks.
+struct RangeAllocator {
+	static const uint32_t INVALID = 0xFFFFFFFF;
+
+	uint32_t capacity = 0;
+	uint32_t freeSpace = 0;
+
+	// Start over with [0, used) allocated and the rest free
+	void reset(uint32_t newCapacity, uint32_t used);
+	// Best fit, returns INVALID when no block is large enough
+	uint32_t allocate(uint32_t size);
+	void free(uint32_t offset, uint32_t size);
+	uint32_t largestFreeBlock() const;
+
+private:
+	// offset -> size
+	std::map<uint32_t, uint32_t> freeBlocks;
+};
+
+// Layout of the commands read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// One level of detail of a heap mesh, indexOffset is relative to the mesh's indexOffset
+struct HeapMeshLOD {
+	uint32_t indexOffset;
+	uint32_t indexCount;
+};
+
+// A mesh stored in the geometry heap, offsets and counts are in vertices and indices.
+// The index range holds every level of detail back to back, finest first
+struct HeapMesh {
+	uint32_t vertexOffset;
+	uint32_t vertexCount;
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	Bounds bounds;
+	HeapMeshLOD lods[MAX_MESH_LODS];
+	// Relative to the bounding sphere radius, see MeshLOD
+	float lodErrors[MAX_MESH_LODS];
+	uint32_t lodCount;
+	bool live;
+};
+
+// Every static mesh in one interleaved vertex buffer of PackedVertex and one index buffer, drawn through a single VAO.
+// Meshes are placed with RangeAllocators and addressed with baseVertex / firstIndex, so any number of
+// them can be drawn without binding anything in between, which is what multi draw indirect needs.
+// When an allocation doesn't fit the live meshes are copied into new buffers back to back, which
+// removes the gaps left by released meshes, and the buffers grow if that is still not enough.
+// Indices are relative to the mesh, so they are 16 bit until a mesh with more than 65536 vertices
+// is uploaded, which widens the whole index buffer to 32 bit.
+class GeometryHeap {
+public:
+	GeometryHeap() = default;
+
+	// Returns the id of the mesh in the heap. Tangents are computed when the mesh has texture coordinates.
+	// Without levels of detail mesh.indices is the only level
+	int upload(const Mesh& mesh, const std::vector<MeshLOD>& lods = std::vector<MeshLOD>());
+	void release(int meshID);
+	const HeapMesh& mesh(int meshID) const { return meshes[meshID]; }
+	// Bytes of vertices and indices the mesh takes up in the heap
+	size_t meshBytes(int meshID) const { return meshes[meshID].vertexCount * sizeof(PackedVertex) + meshes[meshID].indexCount * indexSize(); }
+
+	GLuint vertexArray() const { return vao; }
+	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, the same for every mesh in the heap
+	GLenum indexType() const { return wideIndices ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT; }
+	GLsizeiptr indexSize() const { return wideIndices ? sizeof(GLuint) : sizeof(GLushort); }
+
+	// Copy the live meshes to the front of new buffers, ids stay valid
+	void compact();
+
+private:
+	void reallocate(uint32_t vertexCapacity, uint32_t indexCapacity, bool newWideIndices);
+	void writeIndices(uint32_t offset, const std::vector<unsigned int>& data);
+
+	// Disable copying and assignment
+	GeometryHeap(GeometryHeap const &) = delete;
+	GeometryHeap & operator =(GeometryHeap const &) = delete;
+
+	GLuint vao = 0;
+	GLuint vertexBuffer = 0;
+	GLuint indexBuffer = 0;
+	bool wideIndices = false;
+
+	RangeAllocator vertices;
+	RangeAllocator indices;
+
+	std::vector<HeapMesh> meshes;
+	std::vector<int> freeMeshIDs;
+};
@@ -1,6 +1,7 @@
 #include <glad/glad.h>
 #include <program.hpp>
 #include "glutils.h"
+#include <algorithm>
 #include <vector>
 #include <iostream>
 
@@ -17,7 +18,14 @@ unsigned int generateAttribute(GLuint id, int elementsPerEntry, std::vector<T> d
 
 // TODO: use enum bitmask for dynamic configuration
 GLIds generateBuffer(const Mesh &mesh, bool dynamicTexture) {
-	GLIds ids; 
+	if (GLAD_GL_ARB_direct_state_access) {
+		return createImmutableBuffer(mesh, dynamicTexture);
+	}
+	return generateMutableBuffer(mesh, dynamicTexture);
+}
+
+GLIds generateMutableBuffer(const Mesh &mesh, bool dynamicTexture) {
+	GLIds ids = {};
 
     glGenVertexArrays(1, &ids.vao);
     glBindVertexArray(ids.vao);
@@ -34,9 +42,45 @@ GLIds generateBuffer(const Mesh &mesh, bool dynamicTexture) {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ids.index);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
 
+    ids.bounds = computeBounds(mesh);
+
     return ids;
 }
 
+// Every attribute has its own buffer and binding point, the binding index is the attribute location
+template <class T>
+GLuint createImmutableAttribute(GLuint vao, GLuint location, int elementsPerEntry, const std::vector<T>& data, bool normalize, bool dynamic) {
+	GLuint bufferID;
+	glCreateBuffers(1, &bufferID);
+	glNamedBufferStorage(bufferID, data.size() * sizeof(T), data.data(), dynamic ? GL_DYNAMIC_STORAGE_BIT : 0);
+	glVertexArrayVertexBuffer(vao, location, bufferID, 0, sizeof(T));
+	glVertexArrayAttribFormat(vao, location, elementsPerEntry, GL_FLOAT, normalize ? GL_TRUE : GL_FALSE, 0);
+	glVertexArrayAttribBinding(vao, location, location);
+	glEnableVertexArrayAttrib(vao, location);
+	return bufferID;
+}
+
+GLIds createImmutableBuffer(const Mesh &mesh, bool dynamicTexture) {
+	GLIds ids = {};
+	glCreateVertexArrays(1, &ids.vao);
+
+	ids.vertex = createImmutableAttribute(ids.vao, 0, 3, mesh.vertices, false, false);
+	if (mesh.normals.size() > 0) {
+		ids.normal = createImmutableAttribute(ids.vao, 1, 3, mesh.normals, true, false);
+	}
+	if (mesh.textureCoordinates.size() > 0) {
+		ids.texture = createImmutableAttribute(ids.vao, 2, 2, mesh.textureCoordinates, false, dynamicTexture);
+	}
+
+	glCreateBuffers(1, &ids.index);
+	glNamedBufferStorage(ids.index, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), 0);
+	glVertexArrayElementBuffer(ids.vao, ids.index);
+
+	ids.bounds = computeBounds(mesh);
+
+	return ids;
+}
+
 struct Tangents {
 	glm::vec3 tangent;
 	glm::vec3 bitTangent;
@@ -59,23 +103,22 @@ inline Tangents computeTangents(const glm::vec3& deltaPos1, const glm::vec3& del
 	};
 }
 
-// GEOMETRY_NORMAL_MAPPED nodes should call this before being rendered
-void appendTBNBuffer(Mesh &mesh, GLIds* ids) {
+void computeTBN(const Mesh &mesh, std::vector<glm::vec3>& tangents, std::vector<glm::vec3>& bitTangents) {
 	unsigned int vertSize = mesh.vertices.size();
 
-	std::vector<glm::vec3> tangents;
-	std::vector<glm::vec3> bitTangents;
+	tangents.clear();
+	bitTangents.clear();
 	tangents.reserve(vertSize);
 	bitTangents.reserve(vertSize);
 
 	for (int i = 0; i + 2 < mesh.vertices.size(); i += 3) {
-		glm::vec3& v0 = mesh.vertices[i];
-		glm::vec3& v1 = mesh.vertices[i + 1];
-		glm::vec3& v2 = mesh.vertices[i + 2];
+		const glm::vec3& v0 = mesh.vertices[i];
+		const glm::vec3& v1 = mesh.vertices[i + 1];
+		const glm::vec3& v2 = mesh.vertices[i + 2];
 
-		glm::vec2& uv0 = mesh.textureCoordinates[i];
-		glm::vec2& uv1 = mesh.textureCoordinates[i + 1];
-		glm::vec2& uv2 = mesh.textureCoordinates[i + 2];
+		const glm::vec2& uv0 = mesh.textureCoordinates[i];
+		const glm::vec2& uv1 = mesh.textureCoordinates[i + 1];
+		const glm::vec2& uv2 = mesh.textureCoordinates[i + 2];
 
 		Tangents tangents1 = computeTangents(v1 - v0, v2 - v0, uv1 - uv0, uv2 - uv0);
 		Tangents tangents2 = computeTangents(v2 - v1, v0 - v1, uv2 - uv1, uv0 - uv1);
@@ -89,6 +132,13 @@ void appendTBNBuffer(Mesh &mesh, GLIds* ids) {
 		bitTangents.push_back(tangents2.bitTangent);
 		bitTangents.push_back(tangents3.bitTangent);
 	}
+}
+
+// GEOMETRY_NORMAL_MAPPED nodes should call this before being rendered
+void appendTBNBuffer(Mesh &mesh, GLIds* ids) {
+	std::vector<glm::vec3> tangents;
+	std::vector<glm::vec3> bitTangents;
+	computeTBN(mesh, tangents, bitTangents);
 
 	glBindVertexArray(ids->vao);
 
@@ -99,6 +149,13 @@ void appendTBNBuffer(Mesh &mesh, GLIds* ids) {
 }
 
 GLuint generateTexture(const PNGImage &pngImage, GLint format) {
+	if (GLAD_GL_ARB_direct_state_access) {
+		return createImmutableTexture(pngImage, format);
+	}
+	return generateMutableTexture(pngImage, format);
+}
+
+GLuint generateMutableTexture(const PNGImage &pngImage, GLint format) {
 	GLuint id;
 	glGenTextures(1, &id);
 	glBindTexture(GL_TEXTURE_2D, id);
@@ -112,3 +169,97 @@ GLuint generateTexture(const PNGImage &pngImage, GLint format) {
 	glBindTexture(GL_TEXTURE_2D, 0);
 	return id;
 }
+
+GLuint createImmutableTexture(const PNGImage &pngImage, GLint format) {
+	// Immutable storage needs a sized format, the PNG pixels are always RGBA
+	const GLenum internalFormat = format == GL_R8 ? GL_R8 : GL_RGBA8;
+	GLsizei levels = 1;
+	while ((std::max(pngImage.width, pngImage.height) >> levels) > 0) {
+		levels++;
+	}
+
+	GLuint id;
+	glCreateTextures(GL_TEXTURE_2D, 1, &id);
+	glTextureStorage2D(id, levels, internalFormat, pngImage.width, pngImage.height);
+	glTextureSubImage2D(id, 0, 0, 0, pngImage.width, pngImage.height, GL_RGBA, GL_UNSIGNED_BYTE, pngImage.pixels.data());
+
+	glGenerateTextureMipmap(id);
+	glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return id;
+}
+
+// S3TC is an extension, but every desktop driver exposes it
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+TextureFileGLFormat textureFileGLFormat(TextureFileFormat format) {
+	static const TextureFileGLFormat formats[MAX_TEXTURE_FILE_FORMATS] = {
+		{ GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE },
+		{ GL_R8, GL_RED, GL_UNSIGNED_BYTE },
+		{ GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 0, 0 },
+		{ GL_COMPRESSED_RED_RGTC1, 0, 0 },
+		{ GL_COMPRESSED_RG_RGTC2, 0, 0 },
+		{ GL_COMPRESSED_RGBA_BPTC_UNORM, 0, 0 },
+	};
+	return formats[format];
+}
+
+void uploadTextureLevel(GLuint texture, GLint level, TextureFileFormat format, const TextureFileLevel& size, const void* data) {
+	const TextureFileGLFormat glFormat = textureFileGLFormat(format);
+	if (!GLAD_GL_ARB_direct_state_access) {
+		if (isBlockCompressed(format)) {
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, size.width, size.height, glFormat.internalFormat, size.size, data);
+		}
+		else {
+			glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, size.width, size.height, glFormat.format, glFormat.type, data);
+		}
+	}
+	else if (isBlockCompressed(format)) {
+		glCompressedTextureSubImage2D(texture, level, 0, 0, size.width, size.height, glFormat.internalFormat, size.size, data);
+	}
+	else {
+		glTextureSubImage2D(texture, level, 0, 0, size.width, size.height, glFormat.format, glFormat.type, data);
+	}
+}
+
+GLuint generateTexture(const MappedFile &textureFile) {
+	const TextureFileHeader* header = validTextureFile(textureFile);
+	const TextureFileGLFormat format = textureFileGLFormat(TextureFileFormat(header->format));
+	const TextureFileLevel* levels = header->levels;
+	// Rows of one byte texels are not padded to 4 bytes in the file
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	GLuint id;
+	if (GLAD_GL_ARB_direct_state_access) {
+		glCreateTextures(GL_TEXTURE_2D, 1, &id);
+		glTextureStorage2D(id, header->levelCount, format.internalFormat, levels[0].width, levels[0].height);
+		for (GLuint level = 0; level < header->levelCount; level++) {
+			uploadTextureLevel(id, level, TextureFileFormat(header->format), levels[level], textureFile.data() + levels[level].offset);
+		}
+		glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	else {
+		glGenTextures(1, &id);
+		glBindTexture(GL_TEXTURE_2D, id);
+		for (GLuint level = 0; level < header->levelCount; level++) {
+			if (isBlockCompressed(TextureFileFormat(header->format))) {
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, format.internalFormat, levels[level].width, levels[level].height, 0,
+					levels[level].size, textureFile.data() + levels[level].offset);
+			}
+			else {
+				glTexImage2D(GL_TEXTURE_2D, level, format.internalFormat, levels[level].width, levels[level].height, 0,
+					format.format, format.type, textureFile.data() + levels[level].offset);
+			}
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->levelCount - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	return id;
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "mesh.h" // Mesh
+#include "bounds.hpp" // Bounds
 #include "imageLoader.hpp" // PNGImage
+#include "textureFile.hpp" // TextureFileFormat
 #include "glad/glad.h"
 
 // TODO: convert to SOA?
@@ -14,11 +16,24 @@ struct GLIds {
 	// Optionals
 	GLuint tangent;
 	GLuint bitTangent;
+	// Local bounds of the mesh, used for culling
+	Bounds bounds;
 };
 
+// Uses createImmutableBuffer when the context supports direct state access, generateMutableBuffer otherwise
 GLIds generateBuffer(const Mesh &mesh, bool dynamicTexture);
+// Bind to edit path with mutable storage
+GLIds generateMutableBuffer(const Mesh &mesh, bool dynamicTexture);
+// GL 4.5 direct state access path with immutable storage, nothing is bound to create the buffers.
+// Only the texture coordinates of a dynamic buffer can be written to afterwards, with updateBuffer
+GLIds createImmutableBuffer(const Mesh &mesh, bool dynamicTexture);
 
+// Overwrite the start of an attribute buffer. `data` must fit in the buffer, immutable buffers can't grow
 template <class T> void updateBuffer(GLuint vao, GLuint bufferID, const std::vector<T>& data) {
+	if (GLAD_GL_ARB_direct_state_access) {
+		glNamedBufferSubData(bufferID, 0, data.size() * sizeof(T), data.data());
+		return;
+	}
 	glBindVertexArray(vao);
 	glBindBuffer(GL_ARRAY_BUFFER, bufferID);
 	glBufferSubData(GL_ARRAY_BUFFER, 0, data.size() * sizeof(T), data.data());
@@ -26,6 +41,36 @@ template <class T> void updateBuffer(GLuint vao, GLuint bufferID, const std::vec
 	glBindVertexArray(0);
 }
 
+// Bind a 2D texture to a texture unit, through the active unit without direct state access
+inline void bindTextureUnit(GLuint unit, GLuint texture) {
+	if (GLAD_GL_ARB_direct_state_access) {
+		glBindTextureUnit(unit, texture);
+		return;
+	}
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+// Per vertex tangent and bitangent of a triangle list mesh
+void computeTBN(const Mesh &mesh, std::vector<glm::vec3>& tangents, std::vector<glm::vec3>& bitTangents);
 void appendTBNBuffer(Mesh &mesh, GLIds* ids);
 
-GLuint generateTexture(const PNGImage &pngImage, GLint format);
\ No newline at end of file
+// format is GL_RGBA or GL_R8. Uses createImmutableTexture when the context supports direct state access
+GLuint generateTexture(const PNGImage &pngImage, GLint format);
+GLuint generateMutableTexture(const PNGImage &pngImage, GLint format);
+// Immutable storage with the full mip chain, allocated and filled without binding the texture
+GLuint createImmutableTexture(const PNGImage &pngImage, GLint format);
+
+// How the texels of a texture file format are stored and uploaded, format and type are unused for block compressed formats
+struct TextureFileGLFormat {
+	GLenum internalFormat;
+	GLenum format;
+	GLenum type;
+};
+TextureFileGLFormat textureFileGLFormat(TextureFileFormat format);
+// Upload of one level of a texture file into immutable storage. `data` is either a pointer or an offset
+// into the bound pixel unpack buffer. Expects an unpack alignment of 1. Without direct state access the
+// level is written to the texture bound to GL_TEXTURE_2D, which must be `texture`
+void uploadTextureLevel(GLuint texture, GLint level, TextureFileFormat format, const TextureFileLevel& size, const void* data);
+// Every level is uploaded straight from the mapped texture file, which has to be valid (see validTextureFile)
+GLuint generateTexture(const MappedFile &textureFile);
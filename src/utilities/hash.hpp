@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Non cryptographic 64 bit hashes for cache and registry keys. Data in several pieces is hashed by
+// passing the hash of one piece on as the starting value of the next, beginning with the basis.
+
+const uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325ull;
+const uint64_t MURMUR_SEED = 0x9E3779B97F4A7C15ull;
+
+// 64 bit FNV-1a
+inline uint64_t hashFNV1a(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+	}
+	return hash;
+}
+
+// MurmurHash64A. It mixes whole words instead of single bytes, so it is unrelated to FNV-1a
+// and the two together make a 128 bit key
+inline uint64_t hashMurmur64(uint64_t hash, const void* data, size_t size) {
+	const uint64_t m = 0xC6A4A7935BD1E995ull;
+	const int r = 47;
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	hash ^= size * m;
+
+	const size_t words = size / 8;
+	for (size_t i = 0; i < words; i++) {
+		uint64_t k;
+		memcpy(&k, bytes + i * 8, 8);
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+		hash ^= k;
+		hash *= m;
+	}
+	const size_t tail = size % 8;
+	if (tail > 0) {
+		for (size_t i = 0; i < tail; i++) {
+			hash ^= uint64_t(bytes[words * 8 + i]) << (i * 8);
+		}
+		hash *= m;
+	}
+
+	hash ^= hash >> r;
+	hash *= m;
+	hash ^= hash >> r;
+	return hash;
+}
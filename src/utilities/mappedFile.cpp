@@ -0,0 +1,124 @@
+#include "mappedFile.hpp"
+#include <ostream>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) {
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator =(MappedFile&& other) {
+	if (this != &other) {
+		close();
+		std::swap(bytes, other.bytes);
+		std::swap(length, other.length);
+#ifdef _WIN32
+		std::swap(file, other.file);
+		std::swap(mapping, other.mapping);
+#endif
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+	close();
+	HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(fileHandle);
+		return false;
+	}
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr) {
+		CloseHandle(fileHandle);
+		return false;
+	}
+	void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	file = fileHandle;
+	mapping = mappingHandle;
+	bytes = static_cast<const uint8_t*>(view);
+	length = size_t(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::close() {
+	if (bytes != nullptr) UnmapViewOfFile(bytes);
+	if (mapping != nullptr) CloseHandle(mapping);
+	if (file != nullptr) CloseHandle(file);
+	bytes = nullptr;
+	mapping = nullptr;
+	file = nullptr;
+	length = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+	close();
+	int descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) return false;
+
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+		::close(descriptor);
+		return false;
+	}
+	void* view = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+	// The mapping keeps its own reference to the file
+	::close(descriptor);
+	if (view == MAP_FAILED) return false;
+
+	bytes = static_cast<const uint8_t*>(view);
+	length = size_t(status.st_size);
+	return true;
+}
+
+void MappedFile::close() {
+	if (bytes != nullptr) munmap(const_cast<uint8_t*>(bytes), length);
+	bytes = nullptr;
+	length = 0;
+}
+
+#endif
+
+time_t modificationTime(const std::string& path) {
+	struct stat status;
+	if (stat(path.c_str(), &status) != 0) return 0;
+	return status.st_mtime;
+}
+
+void reserveHeader(std::ostream& out, size_t size) {
+	const std::vector<char> zeros(size, 0);
+	out.write(zeros.data(), zeros.size());
+}
+
+bool writeHeader(std::ostream& out, const void* header, size_t size) {
+	out.seekp(0);
+	out.write(static_cast<const char*>(header), size);
+	return bool(out);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <iosfwd>
+#include <string>
+
+// Read only view of a whole file mapped into memory. Pages are loaded by the OS when they are first
+// touched, so opening a large file is constant time and unused parts are never read from disk.
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(MappedFile&& other);
+	MappedFile& operator =(MappedFile&& other);
+
+	// Returns false if the file doesn't exist or can't be mapped
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return bytes != nullptr; }
+	const uint8_t* data() const { return bytes; }
+	size_t size() const { return length; }
+
+private:
+	// Disable copying and assignment
+	MappedFile(MappedFile const &) = delete;
+	MappedFile & operator =(MappedFile const &) = delete;
+
+	const uint8_t* bytes = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
+
+// Modification time of a file, 0 if it doesn't exist
+time_t modificationTime(const std::string& path);
+
+// Files cooked to be mapped start with a header, which is written last: reserveHeader fills its place
+// with zeros, the contents follow, and writeHeader puts the real header in at the end. A file cut short
+// by a crash then never has a valid magic, and its reader rejects it instead of trusting the contents
+void reserveHeader(std::ostream& out, size_t size);
+// Returns false if any write to the file failed
+bool writeHeader(std::ostream& out, const void* header, size_t size);
@@ -0,0 +1,106 @@
+#include "meshRegistry.hpp"
+#include "hash.hpp"
+#include "shapes.h"
+#include <cassert>
+#include <cstdio>
+
+// Exact text of a float, so keys of nearly equal parameters never collide
+std::string floatKey(float value) {
+	char text[32];
+	snprintf(text, sizeof(text), " %a", value);
+	return text;
+}
+
+// Two unrelated 64 bit hashes of the same data
+struct ContentHash {
+	uint64_t fnv = FNV_OFFSET_BASIS;
+	uint64_t murmur = MURMUR_SEED;
+};
+
+template <class T> void hashData(ContentHash& hash, const std::vector<T>& data) {
+	hash.fnv = hashFNV1a(hash.fnv, data.data(), data.size() * sizeof(T));
+	hash.murmur = hashMurmur64(hash.murmur, data.data(), data.size() * sizeof(T));
+}
+
+int MeshRegistry::acquireCube(glm::vec3 scale, glm::vec2 textureScale, bool tilingTextures, bool inverted) {
+	const std::string key = "cube" + floatKey(scale.x) + floatKey(scale.y) + floatKey(scale.z)
+		+ floatKey(textureScale.x) + floatKey(textureScale.y) + (tilingTextures ? " tiling" : "") + (inverted ? " inverted" : "");
+	int meshID = find(key);
+	if (meshID == -1) {
+		meshID = insert(key, cube(scale, textureScale, tilingTextures, inverted), std::vector<MeshLOD>());
+	}
+	return meshID;
+}
+
+int MeshRegistry::acquireSphere(float radius, int slices, int layers) {
+	const std::string key = "sphere" + floatKey(radius) + " " + std::to_string(slices) + " " + std::to_string(layers);
+	int meshID = find(key);
+	if (meshID == -1) {
+		meshID = insert(key, generateSphere(radius, slices, layers), std::vector<MeshLOD>());
+	}
+	return meshID;
+}
+
+int MeshRegistry::acquire(const Mesh& mesh, const std::vector<MeshLOD>& lods) {
+	ContentHash hash;
+	hashData(hash, mesh.vertices);
+	hashData(hash, mesh.normals);
+	hashData(hash, mesh.textureCoordinates);
+	hashData(hash, mesh.indices);
+	for (const MeshLOD& lod : lods) {
+		hashData(hash, lod.indices);
+	}
+	// The contents are not compared on a hit, equal keys are taken to be equal meshes. Different meshes
+	// would need the same sizes and a collision of both hashes, which is unlikely enough to be ignored
+	char key[128];
+	snprintf(key, sizeof(key), "content %016llx%016llx %zu %zu %zu %zu %zu", (unsigned long long)hash.fnv, (unsigned long long)hash.murmur,
+		mesh.vertices.size(), mesh.normals.size(), mesh.textureCoordinates.size(), mesh.indices.size(), lods.size());
+
+	int meshID = find(key);
+	if (meshID == -1) {
+		meshID = insert(key, mesh, lods);
+	}
+	return meshID;
+}
+
+void MeshRegistry::addReference(int meshID) {
+	auto entry = entries.find(meshID);
+	assert(entry != entries.end() && "Mesh is not in the registry");
+	entry->second.references++;
+}
+
+void MeshRegistry::release(int meshID) {
+	auto entry = entries.find(meshID);
+	assert(entry != entries.end() && "Mesh is not in the registry");
+	if (--entry->second.references > 0) return;
+
+	meshIDs.erase(entry->second.key);
+	entries.erase(entry);
+	geometryHeap.release(meshID);
+}
+
+MeshRegistryStats MeshRegistry::stats() const {
+	MeshRegistryStats stats;
+	for (const auto& entry : entries) {
+		const size_t bytes = geometryHeap.meshBytes(entry.first);
+		stats.meshes++;
+		stats.references += entry.second.references;
+		stats.residentBytes += bytes;
+		stats.sharedBytes += bytes * (entry.second.references - 1);
+	}
+	return stats;
+}
+
+int MeshRegistry::find(const std::string& key) {
+	auto found = meshIDs.find(key);
+	if (found == meshIDs.end()) return -1;
+	entries[found->second].references++;
+	return found->second;
+}
+
+int MeshRegistry::insert(const std::string& key, const Mesh& mesh, const std::vector<MeshLOD>& lods) {
+	const int meshID = geometryHeap.upload(mesh, lods);
+	meshIDs[key] = meshID;
+	entries[meshID] = { key, 1 };
+	return meshID;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "geometryHeap.hpp"
+
+// Memory of the meshes in a MeshRegistry
+struct MeshRegistryStats {
+	unsigned int meshes = 0;
+	unsigned int references = 0;
+	// Vertices and indices of every mesh in the geometry heap
+	size_t residentBytes = 0;
+	// What the references after the first would have cost if every request uploaded its own copy
+	size_t sharedBytes = 0;
+};
+
+// Shares identical meshes in the geometry heap. Generated shapes are keyed by their generator and its
+// parameters, other meshes by a hash of their contents, so every request for the same mesh gets the same
+// heap mesh id. Meshes are reference counted, the heap mesh is released with the last reference.
+class MeshRegistry {
+public:
+	explicit MeshRegistry(GeometryHeap& heap) : geometryHeap(heap) {}
+
+	// Generated on the first request, later requests only add a reference
+	int acquireCube(glm::vec3 scale = glm::vec3(1), glm::vec2 textureScale = glm::vec2(1), bool tilingTextures = false, bool inverted = false);
+	int acquireSphere(float radius, int slices, int layers);
+	// Uploaded unless a mesh with the same vertices, indices and levels of detail is already in the registry
+	int acquire(const Mesh& mesh, const std::vector<MeshLOD>& lods = std::vector<MeshLOD>());
+	// Another reference to a mesh from this registry
+	void addReference(int meshID);
+	void release(int meshID);
+
+	GeometryHeap& heap() { return geometryHeap; }
+	MeshRegistryStats stats() const;
+
+private:
+	struct Entry {
+		std::string key;
+		unsigned int references;
+	};
+
+	// Adds a reference to the mesh of `key` and returns it, -1 when the key is not registered yet
+	int find(const std::string& key);
+	int insert(const std::string& key, const Mesh& mesh, const std::vector<MeshLOD>& lods);
+
+	// Disable copying and assignment
+	MeshRegistry(MeshRegistry const &) = delete;
+	MeshRegistry & operator =(MeshRegistry const &) = delete;
+
+	GeometryHeap& geometryHeap;
+	std::unordered_map<std::string, int> meshIDs;
+	// By heap mesh id
+	std::unordered_map<int, Entry> entries;
+};
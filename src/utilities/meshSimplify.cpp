@@ -0,0 +1,264 @@
+#include "meshSimplify.hpp"
+#include "bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+
+void weldMesh(Mesh& mesh) {
+	const bool hasNormals = mesh.normals.size() == mesh.vertices.size();
+	const bool hasTextureCoordinates = mesh.textureCoordinates.size() == mesh.vertices.size();
+
+	// Ordered on the float values, so 0 and -0 are the same vertex
+	typedef std::tuple<float, float, float, float, float, float, float, float> VertexKey;
+	std::map<VertexKey, unsigned int> unique;
+	std::vector<unsigned int> remap(mesh.vertices.size());
+	Mesh welded;
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		const glm::vec3& position = mesh.vertices[i];
+		const glm::vec3 normal = hasNormals ? mesh.normals[i] : glm::vec3(0);
+		const glm::vec2 uv = hasTextureCoordinates ? mesh.textureCoordinates[i] : glm::vec2(0);
+		const VertexKey key(position.x, position.y, position.z, normal.x, normal.y, normal.z, uv.x, uv.y);
+
+		auto found = unique.find(key);
+		if (found != unique.end()) {
+			remap[i] = found->second;
+			continue;
+		}
+		remap[i] = welded.vertices.size();
+		unique[key] = remap[i];
+		welded.vertices.push_back(position);
+		if (hasNormals) welded.normals.push_back(normal);
+		if (hasTextureCoordinates) welded.textureCoordinates.push_back(uv);
+	}
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		const unsigned int a = remap[mesh.indices[i]];
+		const unsigned int b = remap[mesh.indices[i + 1]];
+		const unsigned int c = remap[mesh.indices[i + 2]];
+		if (a == b || b == c || c == a) continue;
+		welded.indices.push_back(a);
+		welded.indices.push_back(b);
+		welded.indices.push_back(c);
+	}
+	mesh = welded;
+}
+
+// Symmetric 4x4 matrix summing the squared distances to a set of planes
+struct Quadric {
+	double a2 = 0, ab = 0, ac = 0, ad = 0;
+	double b2 = 0, bc = 0, bd = 0;
+	double c2 = 0, cd = 0;
+	double d2 = 0;
+
+	void addPlane(const glm::vec3& normal, float distance) {
+		const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+		a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+		b2 += b * b; bc += b * c; bd += b * d;
+		c2 += c * c; cd += c * d;
+		d2 += d * d;
+	}
+
+	void add(const Quadric& q) {
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd;
+		d2 += q.d2;
+	}
+
+	double evaluate(const glm::vec3& p) const {
+		const double x = p.x, y = p.y, z = p.z;
+		const double result = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+			+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+			+ c2 * z * z + 2 * cd * z
+			+ d2;
+		return std::max(result, 0.0);
+	}
+};
+
+// Moving `from` onto `to`, the versions detect candidates made stale by later collapses
+struct Collapse {
+	double cost;
+	unsigned int from;
+	unsigned int to;
+	unsigned int fromVersion;
+	unsigned int toVersion;
+
+	bool operator >(const Collapse& other) const { return cost > other.cost; }
+};
+
+struct Simplifier {
+	const std::vector<glm::vec3>& positions;
+	std::vector<unsigned int> triangles;
+	std::vector<unsigned char> triangleAlive;
+	std::vector<std::vector<unsigned int>> vertexTriangles;
+	std::vector<Quadric> quadrics;
+	std::vector<unsigned char> locked;
+	std::vector<unsigned char> removed;
+	std::vector<unsigned int> version;
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> candidates;
+
+	explicit Simplifier(const std::vector<glm::vec3>& positions) : positions(positions) {}
+
+	void push(unsigned int from, unsigned int to) {
+		if (locked[from]) return;
+		Quadric q = quadrics[from];
+		q.add(quadrics[to]);
+		candidates.push({ q.evaluate(positions[to]), from, to, version[from], version[to] });
+	}
+
+	// Moving `from` must not flip or collapse any triangle that is kept
+	bool isValid(unsigned int from, unsigned int to) const {
+		for (unsigned int t : vertexTriangles[from]) {
+			if (!triangleAlive[t]) continue;
+			const unsigned int* corners = &triangles[t * 3];
+			if (corners[0] == to || corners[1] == to || corners[2] == to) continue;
+
+			glm::vec3 before[3];
+			glm::vec3 after[3];
+			for (int i = 0; i < 3; i++) {
+				before[i] = positions[corners[i]];
+				after[i] = corners[i] == from ? positions[to] : before[i];
+			}
+			const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			if (glm::dot(normalBefore, normalAfter) <= 0.0f) return false;
+		}
+		return true;
+	}
+
+	// Returns the number of triangles removed
+	unsigned int collapse(unsigned int from, unsigned int to) {
+		unsigned int killed = 0;
+		for (unsigned int t : vertexTriangles[from]) {
+			if (!triangleAlive[t]) continue;
+			unsigned int* corners = &triangles[t * 3];
+			if (corners[0] == to || corners[1] == to || corners[2] == to) {
+				triangleAlive[t] = false;
+				killed++;
+				continue;
+			}
+			for (int i = 0; i < 3; i++) {
+				if (corners[i] == from) corners[i] = to;
+			}
+			vertexTriangles[to].push_back(t);
+		}
+		vertexTriangles[from].clear();
+		removed[from] = true;
+		quadrics[to].add(quadrics[from]);
+		version[to]++;
+
+		// Drop the dead triangles and queue the edges around the merged vertex with its new quadric
+		std::vector<unsigned int>& around = vertexTriangles[to];
+		around.erase(std::remove_if(around.begin(), around.end(), [&](unsigned int t) { return !triangleAlive[t]; }), around.end());
+		for (unsigned int t : around) {
+			for (int i = 0; i < 3; i++) {
+				const unsigned int other = triangles[t * 3 + i];
+				if (other == to) continue;
+				push(to, other);
+				push(other, to);
+			}
+		}
+		return killed;
+	}
+};
+
+std::vector<unsigned int> simplifyMesh(const Mesh& mesh, const std::vector<unsigned int>& indices, size_t targetIndexCount, float& error) {
+	error = 0;
+	const size_t vertexCount = mesh.vertices.size();
+	Simplifier s(mesh.vertices);
+	s.triangles = indices;
+	s.triangleAlive.assign(indices.size() / 3, true);
+	s.vertexTriangles.resize(vertexCount);
+	s.quadrics.resize(vertexCount);
+	s.locked.assign(vertexCount, false);
+	s.removed.assign(vertexCount, false);
+	s.version.assign(vertexCount, 0);
+
+	// Edges used by a single triangle are open, count every edge once per direction independent key
+	std::unordered_map<uint64_t, unsigned int> edgeUses;
+	for (size_t t = 0; t < s.triangleAlive.size(); t++) {
+		const unsigned int* corners = &indices[t * 3];
+		const glm::vec3& p0 = mesh.vertices[corners[0]];
+		glm::vec3 normal = glm::cross(mesh.vertices[corners[1]] - p0, mesh.vertices[corners[2]] - p0);
+		const float length = glm::length(normal);
+		if (length > 0) {
+			normal = normal / length;
+			for (int i = 0; i < 3; i++) {
+				s.quadrics[corners[i]].addPlane(normal, -glm::dot(normal, p0));
+			}
+		}
+		for (int i = 0; i < 3; i++) {
+			s.vertexTriangles[corners[i]].push_back(t);
+			const unsigned int a = std::min(corners[i], corners[(i + 1) % 3]);
+			const unsigned int b = std::max(corners[i], corners[(i + 1) % 3]);
+			edgeUses[(uint64_t(a) << 32) | b]++;
+		}
+	}
+	for (const auto& edge : edgeUses) {
+		if (edge.second == 1) {
+			s.locked[edge.first >> 32] = true;
+			s.locked[edge.first & 0xFFFFFFFF] = true;
+		}
+	}
+
+	for (const auto& edge : edgeUses) {
+		const unsigned int a = edge.first >> 32;
+		const unsigned int b = edge.first & 0xFFFFFFFF;
+		s.push(a, b);
+		s.push(b, a);
+	}
+
+	size_t triangleCount = s.triangleAlive.size();
+	const size_t targetTriangles = targetIndexCount / 3;
+	double maxCost = 0;
+	while (triangleCount > targetTriangles && !s.candidates.empty()) {
+		const Collapse candidate = s.candidates.top();
+		s.candidates.pop();
+		if (s.removed[candidate.from] || s.removed[candidate.to]
+			|| s.version[candidate.from] != candidate.fromVersion || s.version[candidate.to] != candidate.toVersion) {
+			continue;
+		}
+		if (!s.isValid(candidate.from, candidate.to)) {
+			continue;
+		}
+		maxCost = std::max(maxCost, candidate.cost);
+		triangleCount -= s.collapse(candidate.from, candidate.to);
+	}
+	error = float(std::sqrt(maxCost));
+
+	std::vector<unsigned int> result;
+	result.reserve(triangleCount * 3);
+	for (size_t t = 0; t < s.triangleAlive.size(); t++) {
+		if (!s.triangleAlive[t]) continue;
+		result.insert(result.end(), s.triangles.begin() + t * 3, s.triangles.begin() + t * 3 + 3);
+	}
+	return result;
+}
+
+// A level is only kept when it removes at least this fraction of the previous level's triangles
+const float MIN_LOD_REDUCTION = 0.2f;
+
+std::vector<MeshLOD> generateLODChain(const Mesh& mesh) {
+	std::vector<MeshLOD> lods;
+	lods.push_back({ mesh.indices, 0.0f });
+
+	const float radius = computeBounds(mesh).sphere.radius;
+	while (lods.size() < MAX_MESH_LODS) {
+		const MeshLOD& previous = lods.back();
+		const size_t target = previous.indices.size() / 6 * 3;
+		float error;
+		std::vector<unsigned int> indices = simplifyMesh(mesh, previous.indices, target, error);
+		if (indices.empty() || float(indices.size()) > float(previous.indices.size()) * (1.0f - MIN_LOD_REDUCTION)) {
+			break;
+		}
+		// Each level is simplified from the previous one, so the errors add up
+		const float relativeError = radius > 0 ? error / radius : 0.0f;
+		lods.push_back({ std::move(indices), previous.error + relativeError });
+	}
+	return lods;
+}
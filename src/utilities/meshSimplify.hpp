@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+
+// Levels of detail kept per mesh, including the full detail mesh
+const unsigned int MAX_MESH_LODS = 4;
+
+// One level of detail of a mesh, an index buffer into the vertices of the full detail mesh
+struct MeshLOD {
+	std::vector<unsigned int> indices;
+	// Largest distance the surface moved from the full detail mesh, relative to the mesh's bounding radius
+	float error;
+};
+
+// Merge vertices whose position, normal and texture coordinates are all equal and drop the triangles
+// that became degenerate. Shapes are generated with separate vertices per triangle, which leaves nothing
+// for the simplifier to collapse
+void weldMesh(Mesh& mesh);
+
+// Quadric error edge collapse (Garland and Heckbert). Collapses the cheapest edges of the triangles in `indices`
+// until at most targetIndexCount indices are left or no edge can be collapsed without flipping a triangle.
+// Vertices on open edges, which includes texture and normal seams, are never moved so the mesh doesn't tear.
+// Returns indices into mesh.vertices, `error` is set to the largest distance a vertex moved from the surface
+std::vector<unsigned int> simplifyMesh(const Mesh& mesh, const std::vector<unsigned int>& indices, size_t targetIndexCount, float& error);
+
+// LOD 0 is mesh.indices and every next level has about half the triangles of the previous one.
+// The chain ends early when a level can't be reduced any further
+std::vector<MeshLOD> generateLODChain(const Mesh& mesh);
@@ -0,0 +1,88 @@
+#include "programCache.hpp"
+#include "hash.hpp"
+#include "mappedFile.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+std::string programCachePath(uint64_t key) {
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+	return PROGRAM_CACHE_DIRECTORY + std::string(name);
+}
+
+bool programCacheSupported() {
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+uint64_t programCacheKey(const std::vector<std::string>& sources) {
+	uint64_t hash = FNV_OFFSET_BASIS;
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (GLenum name : driverStrings) {
+		const char* text = (const char*)glGetString(name);
+		if (text != nullptr) hash = hashFNV1a(hash, text, strlen(text) + 1);
+	}
+	for (const std::string& source : sources) {
+		// The terminator separates the sources, moving text from one to the next changes the key
+		hash = hashFNV1a(hash, source.c_str(), source.size() + 1);
+	}
+	return hash;
+}
+
+bool loadProgramBinary(GLuint program, uint64_t key) {
+	if (!programCacheSupported()) return false;
+	MappedFile file;
+	if (!file.open(programCachePath(key))) return false;
+	const ProgramCacheHeader* header = reinterpret_cast<const ProgramCacheHeader*>(file.data());
+	if (file.size() < sizeof(ProgramCacheHeader) || header->magic != PROGRAM_CACHE_MAGIC || header->version != PROGRAM_CACHE_VERSION
+		|| header->key != key || file.size() < sizeof(ProgramCacheHeader) + header->binarySize) {
+		return false;
+	}
+
+	glProgramBinary(program, header->binaryFormat, file.data() + sizeof(ProgramCacheHeader), header->binarySize);
+	// A driver update that keeps the version string can still reject the binary
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	return status == GL_TRUE;
+}
+
+void storeProgramBinary(GLuint program, uint64_t key) {
+	if (!programCacheSupported()) return;
+	GLint size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0) return;
+	std::vector<char> binary(size);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(program, size, nullptr, &binaryFormat, binary.data());
+
+#ifdef _WIN32
+	_mkdir(PROGRAM_CACHE_DIRECTORY);
+#else
+	mkdir(PROGRAM_CACHE_DIRECTORY, 0755);
+#endif
+	const std::string path = programCachePath(key);
+	std::ofstream out(path, std::ios::binary);
+	if (!out) {
+		fprintf(stderr, "Could not write program cache file %s\n", path.c_str());
+		return;
+	}
+	ProgramCacheHeader header = {};
+	reserveHeader(out, sizeof(header));
+	out.write(binary.data(), binary.size());
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.version = PROGRAM_CACHE_VERSION;
+	header.key = key;
+	header.binaryFormat = binaryFormat;
+	header.binarySize = uint32_t(binary.size());
+	if (!writeHeader(out, &header, sizeof(header))) {
+		fprintf(stderr, "Could not write program cache file %s\n", path.c_str());
+	}
+}
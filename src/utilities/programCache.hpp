@@ -0,0 +1,34 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Linked programs are saved with glGetProgramBinary and loaded with glProgramBinary on later runs, which
+// skips compiling and linking the GLSL. A binary is keyed by a hash of every source of the program and of
+// the vendor, renderer and version strings of the driver, so a changed source or a driver update misses
+// the cache and the program is compiled again. The driver may still reject a binary, the caller then
+// compiles the sources as if there was no cache.
+
+const uint32_t PROGRAM_CACHE_MAGIC = 0x50434247; // "GBCP"
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+// Relative to the working directory, like the resource paths
+const char* const PROGRAM_CACHE_DIRECTORY = "../shadercache";
+
+struct ProgramCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t binaryFormat;
+	uint32_t binarySize;
+};
+
+// False when the driver offers no binary formats, every program is compiled then
+bool programCacheSupported();
+// Hash of the driver and of the sources in the order they are attached
+uint64_t programCacheKey(const std::vector<std::string>& sources);
+// Returns true when the cached binary was loaded and the program is linked
+bool loadProgramBinary(GLuint program, uint64_t key);
+// The program has to be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+void storeProgramBinary(GLuint program, uint64_t key);
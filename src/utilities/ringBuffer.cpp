@@ -0,0 +1,100 @@
+#include "ringBuffer.hpp"
+#include <algorithm>
+#include <cassert>
+
+// Regions start on a multiple of this so offsets aligned within a region are aligned in the buffer
+const size_t REGION_ALIGNMENT = 256;
+const size_t INITIAL_REGION_SIZE = 1 << 16;
+
+inline size_t alignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void FrameRingBuffer::create(size_t newRegionSize) {
+	if (buffer != 0) {
+		for (unsigned int i = 0; i < FRAMES; i++) {
+			waitForRegion(i);
+		}
+		if (persistent) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		}
+		glDeleteBuffers(1, &buffer);
+	}
+	else {
+		GLint alignment;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		uniformAlignment = alignment;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		storageAlignment = alignment;
+	}
+
+	regionSize = alignUp(newRegionSize, std::max(REGION_ALIGNMENT, std::max(uniformAlignment, storageAlignment)));
+	const size_t totalSize = regionSize * FRAMES;
+	persistent = GLAD_GL_ARB_buffer_storage;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if (persistent) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags);
+		mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags));
+	}
+	else {
+		glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+		mapped = nullptr;
+		staging.resize(regionSize);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void FrameRingBuffer::waitForRegion(unsigned int index) {
+	if (fences[index] == nullptr) return;
+
+	// Only the first wait needs to flush, the fence can't signal before it reaches the GPU
+	GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	while (true) {
+		GLenum result = glClientWaitSync(fences[index], flags, 1000000);
+		if (result != GL_TIMEOUT_EXPIRED) break;
+		flags = 0;
+	}
+	glDeleteSync(fences[index]);
+	fences[index] = nullptr;
+}
+
+void FrameRingBuffer::beginFrame(size_t size) {
+	region = (region + 1) % FRAMES;
+	if (size > regionSize) {
+		create(std::max(size, std::max(regionSize * 2, INITIAL_REGION_SIZE)));
+	}
+	waitForRegion(region);
+	head = 0;
+}
+
+size_t FrameRingBuffer::allocate(size_t size, size_t alignment) {
+	const size_t base = region * regionSize;
+	const size_t offset = alignUp(base + head, alignment);
+	assert(offset + size <= base + regionSize && "Frame wrote more than it passed to beginFrame");
+	head = offset + size - base;
+	return offset;
+}
+
+void* FrameRingBuffer::pointer(size_t offset) {
+	if (persistent) {
+		return mapped + offset;
+	}
+	return staging.data() + (offset - region * regionSize);
+}
+
+void FrameRingBuffer::flush() {
+	// Coherent mappings make the writes visible without doing anything
+	if (persistent || head == 0) return;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, region * regionSize, head, staging.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void FrameRingBuffer::endFrame() {
+	if (!persistent) return;
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Buffer split in one region per frame in flight. The CPU writes everything the GPU needs for a frame
+// linearly into the current region and shaders read it by offset through glBindBufferRange.
+// With ARB_buffer_storage the buffer is mapped once, persistent and coherent, and a fence per region
+// makes sure the CPU only overwrites a region after the GPU has finished the frame that used it.
+// Without it the region is staged on the CPU and uploaded with one glBufferSubData per frame.
+class FrameRingBuffer {
+public:
+	static const unsigned int FRAMES = 3;
+
+	FrameRingBuffer() = default;
+
+	// Start writing the next region, waiting for the GPU if it still reads from it.
+	// `size` is the most the frame will write, including alignment padding. The buffer grows if it doesn't fit
+	void beginFrame(size_t size);
+	// Reserve `size` bytes in the current region, returns the offset from the start of the buffer
+	size_t allocate(size_t size, size_t alignment);
+	// Where to write the bytes reserved at `offset`
+	void* pointer(size_t offset);
+	template <class T> size_t write(const T* data, size_t count, size_t alignment);
+	// Make the frame's writes visible to the GPU, must be called before drawing with them
+	void flush();
+	// Fence the region after the frame's draws have been submitted
+	void endFrame();
+
+	GLuint id() const { return buffer; }
+	bool isPersistent() const { return persistent; }
+
+	// Offset alignments required by glBindBufferRange, queried on the first beginFrame
+	size_t uniformAlignment = 256;
+	size_t storageAlignment = 256;
+
+private:
+	void create(size_t newRegionSize);
+	void waitForRegion(unsigned int region);
+
+	// Disable copying and assignment
+	FrameRingBuffer(FrameRingBuffer const &) = delete;
+	FrameRingBuffer & operator =(FrameRingBuffer const &) = delete;
+
+	GLuint buffer = 0;
+	bool persistent = false;
+	uint8_t* mapped = nullptr;
+	// CPU copy of the current region when the buffer can't be mapped persistently
+	std::vector<uint8_t> staging;
+
+	size_t regionSize = 0;
+	unsigned int region = 0;
+	size_t head = 0;
+	GLsync fences[FRAMES] = { nullptr };
+};
+
+template <class T> size_t FrameRingBuffer::write(const T* data, size_t count, size_t alignment) {
+	const size_t offset = allocate(count * sizeof(T), alignment);
+	T* destination = static_cast<T*>(pointer(offset));
+	for (size_t i = 0; i < count; i++) {
+		destination[i] = data[i];
+	}
+	return offset;
+}
@@ -6,14 +6,23 @@
 #include <glad/glad.h>
 
 // Standard headers
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "programCache.hpp"
 
 
 namespace Gloom
 {
+    // Name and value of each #define added to the sources of a program,
+    // one program is built for every combination the renderer needs
+    typedef std::vector<std::pair<std::string, std::string>> ShaderDefines;
+
     class Shader
     {
     public:
@@ -25,76 +34,143 @@ namespace Gloom
         GLuint get()        { return mProgram; }
         void   destroy()    { glDeleteProgram(mProgram); }
 
-        /* Attach a shader to the current shader program */
-        void attach(std::string const &filename)
+        /* Read a shader source for the program. #include "file" lines are
+           replaced by the file, relative to the including one, and every
+           define is added after the #version line. The source is compiled
+           by link(), unless the linked program is found in the program
+           binary cache */
+        void attach(std::string const &filename,
+                    ShaderDefines const &defines = ShaderDefines())
         {
-            // Load GLSL Shader from source
-            std::ifstream fd(filename.c_str());
-            if (fd.fail())
+            std::vector<std::string> files;
+            std::string src;
+            if (!preprocess(filename, files, src)) return;
+
+            mFilenames.push_back(filename);
+            mSources.push_back(define(src, defines));
+            mIncludes.push_back(files);
+        }
+
+
+        /* Links all attached shaders together into a shader program */
+        void link()
+        {
+            linkAsync();
+            finish();
+        }
+
+
+        /* Start compiling and linking the attached shaders without waiting
+           for the driver. With KHR_parallel_shader_compile the driver works
+           on its own threads until isReady() or finish() */
+        void linkAsync()
+        {
+            // The stage of each source is part of the key, it follows from the extension
+            std::vector<std::string> keySources;
+            for (size_t i = 0; i < mSources.size(); i++)
             {
-                fprintf(stderr,
-                    "Something went wrong when attaching the Shader file at \"%s\".\n"
-                    "The file may not exist or is currently inaccessible.\n",
-                    filename.c_str());
+                keySources.push_back(mFilenames[i].substr(mFilenames[i].rfind(".") + 1));
+                keySources.push_back(mSources[i]);
+            }
+            mKey = programCacheKey(keySources);
+            mPending = true;
+            if (loadProgramBinary(mProgram, mKey))
+            {
+                mFilenames.clear();
+                mSources.clear();
+                mIncludes.clear();
+                mPending = false;
                 return;
             }
-            auto src = std::string(std::istreambuf_iterator<char>(fd),
-                                  (std::istreambuf_iterator<char>()));
 
-            // Create shader object
-            const char * source = src.c_str();
-            auto shader = create(filename);
-            glShaderSource(shader, 1, &source, nullptr);
-            glCompileShader(shader);
-
-            // Display errors
-            glGetShaderiv(shader, GL_COMPILE_STATUS, &mStatus);
-            if (!mStatus)
+            // No status is read until the program is done, reading it makes the driver wait
+            for (size_t i = 0; i < mSources.size(); i++)
             {
-                glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &mLength);
-                std::unique_ptr<char[]> buffer(new char[mLength]);
-                glGetShaderInfoLog(shader, mLength, nullptr, buffer.get());
-                fprintf(stderr, "%s\n%s", filename.c_str(), buffer.get());
+                compile(mFilenames[i], mSources[i]);
             }
+            mSources.clear();
+            glProgramParameteri(mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            glLinkProgram(mProgram);
+        }
 
-            assert(mStatus);
 
-            // Attach shader and free allocated memory
-            glAttachShader(mProgram, shader);
-            glDeleteShader(shader);
+        /* True once the program can be used without blocking. Without
+           KHR_parallel_shader_compile this finishes the program right away */
+        bool isReady()
+        {
+            if (!mPending) return true;
+            if (GLAD_GL_KHR_parallel_shader_compile)
+            {
+                GLint complete = GL_FALSE;
+                glGetProgramiv(mProgram, GL_COMPLETION_STATUS_KHR, &complete);
+                if (!complete) return false;
+            }
+            finish();
+            return true;
         }
 
 
-        /* Links all attached shaders together into a shader program */
-        void link()
+        /* Wait for the program, report errors and store it in the cache */
+        void finish()
         {
-            // Link all attached shaders
-            glLinkProgram(mProgram);
+            if (!mPending) return;
+            mPending = false;
 
             // Display errors
             glGetProgramiv(mProgram, GL_LINK_STATUS, &mStatus);
             if (!mStatus)
             {
+                // report() reuses mStatus for the compile status
+                for (size_t i = 0; i < mShaders.size(); i++)
+                {
+                    report(i);
+                }
+                mStatus = GL_FALSE;
                 glGetProgramiv(mProgram, GL_INFO_LOG_LENGTH, &mLength);
                 std::unique_ptr<char[]> buffer(new char[mLength]);
                 glGetProgramInfoLog(mProgram, mLength, nullptr, buffer.get());
                 fprintf(stderr, "%s\n", buffer.get());
             }
 
+            // Free the shaders, the linked program keeps what it needs
+            for (GLuint shader : mShaders)
+            {
+                glDetachShader(mProgram, shader);
+                glDeleteShader(shader);
+            }
+            mShaders.clear();
+            mFilenames.clear();
+            mIncludes.clear();
+
             assert(mStatus);
+            if (mStatus)
+            {
+                storeProgramBinary(mProgram, mKey);
+            }
         }
 
 
         /* Convenience function that attaches and links a vertex and a
            fragment shader in a shader program */
         void makeBasicShader(std::string const &vertexFilename,
-                             std::string const &fragmentFilename)
+                             std::string const &fragmentFilename,
+                             ShaderDefines const &defines = ShaderDefines())
         {
-            attach(vertexFilename);
-            attach(fragmentFilename);
+            attach(vertexFilename, defines);
+            attach(fragmentFilename, defines);
             link();
         }
 
+        /* Same as makeBasicShader, but only starts the build, see linkAsync */
+        void makeBasicShaderAsync(std::string const &vertexFilename,
+                                  std::string const &fragmentFilename,
+                                  ShaderDefines const &defines = ShaderDefines())
+        {
+            attach(vertexFilename, defines);
+            attach(fragmentFilename, defines);
+            linkAsync();
+        }
+
         /* Convenience function to get a uniforms ID from a string
            containing its name */
         GLint getUniformFromName(std::string const &uniformName) {
@@ -122,6 +198,112 @@ namespace Gloom
         }
 
 
+        /* Start compiling a shader source and attach it to the program */
+        void compile(std::string const &filename, std::string const &src)
+        {
+            // Create shader object
+            const char * source = src.c_str();
+            auto shader = create(filename);
+            glShaderSource(shader, 1, &source, nullptr);
+            glCompileShader(shader);
+
+            glAttachShader(mProgram, shader);
+            mShaders.push_back(shader);
+        }
+
+
+        /* Print the compile errors of an attached shader, if it has any */
+        void report(size_t index)
+        {
+            glGetShaderiv(mShaders[index], GL_COMPILE_STATUS, &mStatus);
+            if (!mStatus)
+            {
+                glGetShaderiv(mShaders[index], GL_INFO_LOG_LENGTH, &mLength);
+                std::unique_ptr<char[]> buffer(new char[mLength]);
+                glGetShaderInfoLog(mShaders[index], mLength, nullptr, buffer.get());
+                fprintf(stderr, "%s\n", mFilenames[index].c_str());
+                // The log names the files by their source string number, see preprocess
+                for (size_t i = 1; i < mIncludes[index].size(); i++)
+                {
+                    fprintf(stderr, "%zu: %s\n", i, mIncludes[index][i].c_str());
+                }
+                fprintf(stderr, "%s", buffer.get());
+            }
+        }
+
+
+        /* Append a source to out with its #include lines replaced by the
+           included files. Each file is included once per shader, like
+           #pragma once. #line directives keep the line numbers of errors
+           right, the source string number is the index of the file in files */
+        static bool preprocess(std::string const &filename,
+                               std::vector<std::string> &files,
+                               std::string &out)
+        {
+            std::ifstream fd(filename.c_str());
+            if (fd.fail())
+            {
+                fprintf(stderr,
+                    "Something went wrong when attaching the Shader file at \"%s\".\n"
+                    "The file may not exist or is currently inaccessible.\n",
+                    filename.c_str());
+                return false;
+            }
+            auto index = files.size();
+            files.push_back(filename);
+            auto directory = filename.substr(0, filename.find_last_of("/\\") + 1);
+
+            std::string line;
+            int number = 0;
+            while (std::getline(fd, line))
+            {
+                number++;
+                auto start = line.find_first_not_of(" \t");
+                if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+                {
+                    out += line;
+                    out += '\n';
+                    continue;
+                }
+
+                auto open = line.find('"', start);
+                auto close = open == std::string::npos ? open : line.find('"', open + 1);
+                if (close == std::string::npos)
+                {
+                    fprintf(stderr, "%s(%d): expected #include \"file\"\n", filename.c_str(), number);
+                    return false;
+                }
+                auto path = directory + line.substr(open + 1, close - open - 1);
+                if (std::find(files.begin(), files.end(), path) == files.end())
+                {
+                    out += "#line 1 " + std::to_string(files.size()) + "\n";
+                    if (!preprocess(path, files, out)) return false;
+                }
+                out += "#line " + std::to_string(number + 1) + " " + std::to_string(index) + "\n";
+            }
+            return true;
+        }
+
+
+        /* Insert a #define for every entry after the #version line, which
+           has to stay the first line of the source */
+        static std::string define(std::string const &src, ShaderDefines const &defines)
+        {
+            if (defines.empty()) return src;
+            auto version = src.find("#version");
+            auto end = version == std::string::npos ? 0 : src.find('\n', version) + 1;
+            auto lines = std::count(src.begin(), src.begin() + end, '\n');
+
+            std::string block;
+            for (auto const &define : defines)
+            {
+                block += "#define " + define.first + " " + define.second + "\n";
+            }
+            block += "#line " + std::to_string(lines + 1) + " 0\n";
+            return src.substr(0, end) + block + src.substr(end);
+        }
+
+
         /* Helper function for creating shaders */
         GLuint create(std::string const &filename)
         {
@@ -146,6 +328,15 @@ namespace Gloom
         GLuint mProgram;
         GLint  mStatus;
         GLint  mLength;
+        // Attached sources waiting for link(), the file names are kept for the error messages
+        std::vector<std::string> mFilenames;
+        std::vector<std::string> mSources;
+        // Files each source was built from, the attached file first
+        std::vector<std::vector<std::string>> mIncludes;
+        // Compiling shaders of a program that is not finished yet
+        std::vector<GLuint> mShaders;
+        uint64_t mKey = 0;
+        bool mPending = false;
     };
 }
 
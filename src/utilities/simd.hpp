@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cmath>
+
+// Thin wrappers around the vector instructions so kernels are written once for every width.
+// AVX2 or SSE4.1 are used when the compiler targets them (see ENABLE_AVX2 in CMakeLists.txt),
+// otherwise WIDTH is 1 and the wrappers are plain float operations.
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+typedef __m256 vfloat;
+const unsigned int WIDTH = 8;
+const char* const SIMD_NAME = "AVX2";
+
+inline vfloat vset(float a) { return _mm256_set1_ps(a); }
+inline vfloat vload(const float* a) { return _mm256_load_ps(a); }
+inline void vstore(float* a, vfloat v) { _mm256_store_ps(a, v); }
+inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+inline vfloat vdiv(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+inline vfloat vfloor(vfloat a) { return _mm256_floor_ps(a); }
+inline vfloat vabs(vfloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+inline vfloat vmin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+// Bit i of the result is set when lane i of a is less than lane i of b
+inline int vlessMask(vfloat a, vfloat b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+
+typedef __m128 vfloat;
+const unsigned int WIDTH = 4;
+const char* const SIMD_NAME = "SSE4.1";
+
+inline vfloat vset(float a) { return _mm_set1_ps(a); }
+inline vfloat vload(const float* a) { return _mm_load_ps(a); }
+inline void vstore(float* a, vfloat v) { _mm_store_ps(a, v); }
+inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+inline vfloat vdiv(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+inline vfloat vfloor(vfloat a) { return _mm_floor_ps(a); }
+inline vfloat vabs(vfloat a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline vfloat vmin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+// Bit i of the result is set when lane i of a is less than lane i of b
+inline int vlessMask(vfloat a, vfloat b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+
+#else
+
+typedef float vfloat;
+const unsigned int WIDTH = 1;
+const char* const SIMD_NAME = "scalar";
+
+inline vfloat vset(float a) { return a; }
+inline vfloat vload(const float* a) { return *a; }
+inline void vstore(float* a, vfloat v) { *a = v; }
+inline vfloat vadd(vfloat a, vfloat b) { return a + b; }
+inline vfloat vsub(vfloat a, vfloat b) { return a - b; }
+inline vfloat vmul(vfloat a, vfloat b) { return a * b; }
+inline vfloat vdiv(vfloat a, vfloat b) { return a / b; }
+inline vfloat vfloor(vfloat a) { return std::floor(a); }
+inline vfloat vabs(vfloat a) { return std::fabs(a); }
+inline vfloat vmin(vfloat a, vfloat b) { return a < b ? a : b; }
+inline vfloat vmax(vfloat a, vfloat b) { return a > b ? a : b; }
+// Bit i of the result is set when lane i of a is less than lane i of b
+inline int vlessMask(vfloat a, vfloat b) { return a < b ? 1 : 0; }
+
+#endif
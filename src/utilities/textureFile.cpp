@@ -0,0 +1,158 @@
+#include "textureFile.hpp"
+#include "blockCompress.hpp"
+#include "threadPool.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <thread>
+
+const char* textureFileFormatName(TextureFileFormat format) {
+	static const char* const names[MAX_TEXTURE_FILE_FORMATS] = { "rgba", "r8", "bc1", "bc4", "bc5", "bc7" };
+	return names[format];
+}
+
+bool isBlockCompressed(TextureFileFormat format) {
+	return format >= TEXTURE_FILE_BC1;
+}
+
+uint32_t textureFileElementSize(TextureFileFormat format) {
+	static const uint32_t sizes[MAX_TEXTURE_FILE_FORMATS] = { 4, 1, 8, 8, 16, 16 };
+	return sizes[format];
+}
+
+uint32_t textureFileLevelSize(TextureFileFormat format, uint32_t width, uint32_t height) {
+	if (isBlockCompressed(format)) {
+		return ((width + 3) / 4) * ((height + 3) / 4) * textureFileElementSize(format);
+	}
+	return width * height * textureFileElementSize(format);
+}
+
+std::string textureFilePath(const std::string& pngPath, TextureFileFormat format) {
+	if (format == TEXTURE_FILE_RGBA8) return pngPath + ".tex";
+	return pngPath + "." + textureFileFormatName(format) + ".tex";
+}
+
+std::vector<PNGImage> buildMipChain(const PNGImage& image) {
+	std::vector<PNGImage> levels(1, image);
+	while (levels.back().width > 1 || levels.back().height > 1) {
+		const PNGImage& source = levels.back();
+		PNGImage level;
+		level.width = std::max(source.width / 2, 1u);
+		level.height = std::max(source.height / 2, 1u);
+		level.pixels.resize(level.width * level.height * 4);
+		for (unsigned int y = 0; y < level.height; y++) {
+			const unsigned int y0 = std::min(y * 2, source.height - 1);
+			const unsigned int y1 = std::min(y * 2 + 1, source.height - 1);
+			for (unsigned int x = 0; x < level.width; x++) {
+				const unsigned int x0 = std::min(x * 2, source.width - 1);
+				const unsigned int x1 = std::min(x * 2 + 1, source.width - 1);
+				for (unsigned int c = 0; c < 4; c++) {
+					const unsigned int sum = source.pixels[(y0 * source.width + x0) * 4 + c] + source.pixels[(y0 * source.width + x1) * 4 + c]
+						+ source.pixels[(y1 * source.width + x0) * 4 + c] + source.pixels[(y1 * source.width + x1) * 4 + c];
+					level.pixels[(y * level.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+		levels.push_back(std::move(level));
+	}
+	return levels;
+}
+
+bool cookTextureFile(const std::string& pngPath, const std::string& texturePath, TextureFileFormat format) {
+	std::vector<unsigned char> png;
+	PNGImage image;
+	unsigned int error = lodepng::load_file(png, pngPath);
+	if (!error) error = lodepng::decode(image.pixels, image.width, image.height, png);
+	if (error) {
+		fprintf(stderr, "Could not decode %s: %s\n", pngPath.c_str(), lodepng_error_text(error));
+		return false;
+	}
+	const std::vector<PNGImage> levels = buildMipChain(image);
+	if (levels.size() > MAX_TEXTURE_LEVELS) {
+		fprintf(stderr, "%s is too large to cook\n", pngPath.c_str());
+		return false;
+	}
+
+	// Several threads may cook the same texture, each writes its own file and the last rename wins
+	const std::string temporaryPath = texturePath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	std::ofstream out(temporaryPath, std::ios::binary);
+	if (!out) {
+		fprintf(stderr, "Could not write texture file %s\n", texturePath.c_str());
+		return false;
+	}
+	TextureFileHeader header = {};
+	reserveHeader(out, sizeof(header));
+	header.magic = TEXTURE_FILE_MAGIC;
+	header.version = TEXTURE_FILE_VERSION;
+	header.format = format;
+	header.levelCount = uint32_t(levels.size());
+
+	std::unique_ptr<ThreadPool> pool;
+	if (isBlockCompressed(format)) {
+		pool.reset(new ThreadPool(std::max(std::thread::hardware_concurrency(), 1u)));
+	}
+	const uint32_t texelSize = textureFileElementSize(format);
+	std::vector<unsigned char> texels;
+	for (size_t i = 0; i < levels.size(); i++) {
+		const PNGImage& level = levels[i];
+		if (pool) {
+			compressImage(level, format, *pool, texels);
+		}
+		else {
+			texels.resize(level.width * level.height * texelSize);
+			for (size_t texel = 0; texel < level.width * level.height; texel++) {
+				std::copy_n(&level.pixels[texel * 4], texelSize, &texels[texel * texelSize]);
+			}
+		}
+		while (out.tellp() % TEXTURE_FILE_ALIGNMENT != 0) out.put('\0');
+		header.levels[i] = { uint32_t(out.tellp()), uint32_t(texels.size()), level.width, level.height };
+		out.write(reinterpret_cast<const char*>(texels.data()), texels.size());
+	}
+
+	writeHeader(out, &header, sizeof(header));
+	out.close();
+	if (!out) {
+		std::remove(temporaryPath.c_str());
+		return false;
+	}
+#ifdef _WIN32
+	// Renaming onto an existing file fails on Windows, so make room first
+	std::remove(texturePath.c_str());
+#endif
+	if (std::rename(temporaryPath.c_str(), texturePath.c_str()) != 0) {
+		std::remove(temporaryPath.c_str());
+		// Another thread has just renamed its copy into place
+		return modificationTime(texturePath) != 0;
+	}
+	return true;
+}
+
+const TextureFileHeader* validTextureFile(const MappedFile& file) {
+	if (!file.isOpen() || file.size() < sizeof(TextureFileHeader)) return nullptr;
+	const TextureFileHeader* header = reinterpret_cast<const TextureFileHeader*>(file.data());
+	if (header->magic != TEXTURE_FILE_MAGIC || header->version != TEXTURE_FILE_VERSION
+		|| header->format >= MAX_TEXTURE_FILE_FORMATS || header->levelCount == 0 || header->levelCount > MAX_TEXTURE_LEVELS) {
+		return nullptr;
+	}
+	for (uint32_t i = 0; i < header->levelCount; i++) {
+		const TextureFileLevel& level = header->levels[i];
+		if (uint64_t(level.offset) + level.size > file.size()
+			|| level.size != textureFileLevelSize(TextureFileFormat(header->format), level.width, level.height)) {
+			return nullptr;
+		}
+	}
+	return header;
+}
+
+bool openTextureFile(const std::string& pngPath, TextureFileFormat format, MappedFile& file) {
+	const std::string texturePath = textureFilePath(pngPath, format);
+	const time_t cooked = modificationTime(texturePath);
+	if (cooked != 0 && cooked >= modificationTime(pngPath) && file.open(texturePath) && validTextureFile(file) != nullptr) {
+		return true;
+	}
+	// Missing, stale or written by an older version
+	file.close();
+	return cookTextureFile(pngPath, texturePath, format) && file.open(texturePath) && validTextureFile(file) != nullptr;
+}
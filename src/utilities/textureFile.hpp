@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "imageLoader.hpp"
+#include "mappedFile.hpp"
+
+// PNGs are cooked into a texture file next to them the first time they are loaded. The file is a header
+// with a table of mip levels followed by the pixels of every level, each level starting on an aligned
+// offset. It is memory mapped and the levels are uploaded straight from the mapping, so loading a
+// texture neither decodes a PNG nor generates mipmaps.
+
+const uint32_t TEXTURE_FILE_MAGIC = 0x58544247; // "GBTX"
+const uint32_t TEXTURE_FILE_VERSION = 1;
+// Enough for a 32768x32768 texture
+const uint32_t MAX_TEXTURE_LEVELS = 16;
+// Levels start on a multiple of this, which satisfies any unpack alignment and lets them be copied as whole cache lines
+const uint32_t TEXTURE_FILE_ALIGNMENT = 64;
+
+enum TextureFileFormat {
+	TEXTURE_FILE_RGBA8,
+	// Only the red channel of the PNG, one byte per texel
+	TEXTURE_FILE_R8,
+	// The block compressed formats (see blockCompress.hpp) store each level as rows of 4x4 blocks.
+	// Opaque RGB, 8 bytes per block
+	TEXTURE_FILE_BC1,
+	// Red channel, 8 bytes per block. For single channel maps like roughness
+	TEXTURE_FILE_BC4,
+	// Red and green channel, 16 bytes per block. For normal maps, the shader reconstructs z
+	TEXTURE_FILE_BC5,
+	// RGBA, 16 bytes per block
+	TEXTURE_FILE_BC7,
+	MAX_TEXTURE_FILE_FORMATS, // !Always last entry!
+};
+
+struct TextureFileLevel {
+	// Byte offset from the start of the file
+	uint32_t offset;
+	uint32_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct TextureFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t levelCount;
+	// Largest level first, down to 1x1
+	TextureFileLevel levels[MAX_TEXTURE_LEVELS];
+};
+
+// Name used in scene files and in the file name of cooked textures
+const char* textureFileFormatName(TextureFileFormat format);
+bool isBlockCompressed(TextureFileFormat format);
+// Bytes per texel of the uncompressed formats, bytes per 4x4 block of the block compressed ones
+uint32_t textureFileElementSize(TextureFileFormat format);
+uint32_t textureFileLevelSize(TextureFileFormat format, uint32_t width, uint32_t height);
+// The cooked file of a PNG, the format is part of the name so one PNG can be cooked in several formats
+std::string textureFilePath(const std::string& pngPath, TextureFileFormat format);
+
+// Box filtered mip chain of an RGBA image, levels[0] is the image itself
+std::vector<PNGImage> buildMipChain(const PNGImage& image);
+// Decode a PNG and write it with its full mip chain. Block compression runs one block row per thread.
+// Returns false if the PNG can't be read or the file can't be written
+bool cookTextureFile(const std::string& pngPath, const std::string& texturePath, TextureFileFormat format);
+// The header of a mapped texture file, null if it is not a complete texture file of this version
+const TextureFileHeader* validTextureFile(const MappedFile& file);
+// Map the texture file cooked from `pngPath`, cooking it first if it is missing, older than the PNG or
+// cooked by another version. Safe to call from several threads at once
+bool openTextureFile(const std::string& pngPath, TextureFileFormat format, MappedFile& file);
@@ -0,0 +1,218 @@
+#include "textureStreamer.hpp"
+#include "glutils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+const GLubyte PLACEHOLDER_COLORS[MAX_PLACEHOLDERS][4] = {
+	{ 128, 128, 128, 255 },
+	{ 128, 128, 255, 255 },
+};
+
+// glCreateTextures makes the texture object right away, a generated name only becomes one when it is first bound
+GLuint newTexture() {
+	GLuint texture;
+	if (GLAD_GL_ARB_direct_state_access) {
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	}
+	else {
+		glGenTextures(1, &texture);
+	}
+	return texture;
+}
+
+TextureStreamer::~TextureStreamer() {
+	stop();
+}
+
+void TextureStreamer::create(size_t stagingSize, unsigned int workerCount) {
+	for (int i = 0; i < MAX_PLACEHOLDERS; i++) {
+		placeholders[i] = newTexture();
+		if (GLAD_GL_ARB_direct_state_access) {
+			glTextureStorage2D(placeholders[i], 1, GL_RGBA8, 1, 1);
+			glTextureSubImage2D(placeholders[i], 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER_COLORS[i]);
+		}
+		else {
+			glBindTexture(GL_TEXTURE_2D, placeholders[i]);
+			glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER_COLORS[i]);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+	}
+
+	// Created once, so it is bound to edit like the frame ring buffer
+	if (GLAD_GL_ARB_buffer_storage) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &stagingBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, stagingBuffer);
+		glBufferStorage(GL_COPY_WRITE_BUFFER, stagingSize, nullptr, flags);
+		staging = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, stagingSize, flags));
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		stagingSpace.reset(uint32_t(stagingSize), 0);
+	}
+
+	stopping = false;
+	for (unsigned int i = 0; i < std::max(workerCount, 1u); i++) {
+		workers.emplace_back(&TextureStreamer::workerLoop, this);
+	}
+}
+
+void TextureStreamer::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	stagingFreed.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+GLuint TextureStreamer::request(const std::string& pngPath, TextureFileFormat format, TexturePlaceholder placeholder) {
+	// Only the name exists until update(), the size is known once the file is decoded
+	const GLuint texture = newTexture();
+	loading[texture] = placeholder;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.push_back({ texture, pngPath, format });
+	}
+	wake.notify_one();
+	return texture;
+}
+
+void TextureStreamer::workerLoop() {
+	while (true) {
+		Request request;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&]() { return stopping || !requests.empty(); });
+			if (stopping) return;
+			request = requests.front();
+			requests.pop_front();
+		}
+
+		Decoded result;
+		load(request, result);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			decoded.push_back(std::move(result));
+		}
+	}
+}
+
+void TextureStreamer::load(const Request& request, Decoded& result) {
+	result.texture = request.texture;
+	result.stagingOffset = RangeAllocator::INVALID;
+	result.size = 0;
+	if (!openTextureFile(request.path, request.format, result.file)) {
+		fprintf(stderr, "Could not load texture %s\n", request.path.c_str());
+		return;
+	}
+
+	// The levels are back to back in the file, so they are copied in one piece. Every staging allocation
+	// is a multiple of the file alignment, which keeps the levels as aligned in the staging buffer as in the file
+	const TextureFileHeader* header = validTextureFile(result.file);
+	const TextureFileLevel& first = header->levels[0];
+	const TextureFileLevel& last = header->levels[header->levelCount - 1];
+	const uint32_t payloadSize = last.offset + last.size - first.offset;
+	result.size = (payloadSize + TEXTURE_FILE_ALIGNMENT - 1) / TEXTURE_FILE_ALIGNMENT * TEXTURE_FILE_ALIGNMENT;
+
+	// Wait for staging memory, textures larger than the whole staging buffer are uploaded from the mapping
+	if (staging != nullptr && result.size <= stagingSpace.capacity) {
+		std::unique_lock<std::mutex> lock(mutex);
+		stagingFreed.wait(lock, [&]() {
+			if (stopping) return true;
+			result.stagingOffset = stagingSpace.allocate(result.size);
+			return result.stagingOffset != RangeAllocator::INVALID;
+		});
+	}
+	if (result.stagingOffset != RangeAllocator::INVALID) {
+		memcpy(staging + result.stagingOffset, result.file.data() + first.offset, payloadSize);
+	}
+}
+
+void TextureStreamer::upload(Decoded& texture) {
+	const TextureFileHeader* header = validTextureFile(texture.file);
+	const TextureFileFormat format = TextureFileFormat(header->format);
+	const TextureFileLevel* levels = header->levels;
+	const GLenum internalFormat = textureFileGLFormat(format).internalFormat;
+	const bool directStateAccess = GLAD_GL_ARB_direct_state_access;
+	if (directStateAccess) {
+		glTextureStorage2D(texture.texture, header->levelCount, internalFormat, levels[0].width, levels[0].height);
+	}
+	else {
+		glBindTexture(GL_TEXTURE_2D, texture.texture);
+		glTexStorage2D(GL_TEXTURE_2D, header->levelCount, internalFormat, levels[0].width, levels[0].height);
+	}
+
+	// With a staging copy the level offsets are relative to its start instead of the start of the file
+	const bool staged = texture.stagingOffset != RangeAllocator::INVALID;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staged ? stagingBuffer : 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (GLuint level = 0; level < header->levelCount; level++) {
+		const uint8_t* pixels = staged
+			? reinterpret_cast<const uint8_t*>(uintptr_t(texture.stagingOffset + levels[level].offset - levels[0].offset))
+			: texture.file.data() + levels[level].offset;
+		uploadTextureLevel(texture.texture, level, format, levels[level], pixels);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (directStateAccess) {
+		glTextureParameteri(texture.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(texture.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	else {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	// The copy out of the staging buffer runs on the GPU, the fence tells when the range can be reused.
+	// Draws submitted after the copy already see the texture, so it stops being a placeholder now
+	if (staged) {
+		uploads.push_back({ texture.texture, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), texture.stagingOffset, texture.size });
+	}
+	loading.erase(texture.texture);
+}
+
+void TextureStreamer::update(size_t maxBytes) {
+	// Retire the copies the GPU has finished
+	bool freed = false;
+	for (size_t i = 0; i < uploads.size();) {
+		if (glClientWaitSync(uploads[i].fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			i++;
+			continue;
+		}
+		glDeleteSync(uploads[i].fence);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stagingSpace.free(uploads[i].stagingOffset, uploads[i].size);
+		}
+		freed = true;
+		uploads[i] = uploads.back();
+		uploads.pop_back();
+	}
+	if (freed) {
+		stagingFreed.notify_all();
+	}
+
+	size_t uploaded = 0;
+	while (uploaded < maxBytes || uploaded == 0) {
+		Decoded texture;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (decoded.empty()) break;
+			texture = std::move(decoded.front());
+			decoded.pop_front();
+		}
+		if (!texture.file.isOpen()) {
+			// Keeps showing the placeholder
+			continue;
+		}
+		upload(texture);
+		uploaded += texture.size;
+	}
+}
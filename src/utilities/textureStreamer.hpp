@@ -0,0 +1,103 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "geometryHeap.hpp" // RangeAllocator
+#include "mappedFile.hpp"
+#include "textureFile.hpp"
+
+// What is shown in place of a texture that is still loading
+enum TexturePlaceholder {
+	PLACEHOLDER_GREY,
+	// (0.5, 0.5, 1), a normal map that leaves the surface normal as it is
+	PLACEHOLDER_FLAT_NORMAL,
+	MAX_PLACEHOLDERS, // !Always last entry!
+};
+
+// Loads textures without stalling the GL thread. Worker threads map the cooked texture file, cooking it
+// first if needed, and copy its levels into a persistently mapped pixel unpack buffer. update() creates the
+// texture storage and copies the levels out of the staging buffer on the GPU, and a fence per texture tells
+// when the staging memory can be reused. Until then resolve() returns a placeholder so the texture can be
+// bound right away. Without ARB_buffer_storage the levels are uploaded straight from the mapped file instead.
+class TextureStreamer {
+public:
+	TextureStreamer() = default;
+	~TextureStreamer();
+
+	// Must be called on the GL thread before the first request
+	void create(size_t stagingSize, unsigned int workerCount);
+	// Stop the workers, textures that haven't arrived yet keep their placeholder
+	void stop();
+
+	// Returns the name of the texture right away, it is filled in by a later update().
+	// The placeholder is what resolve() returns until then
+	GLuint request(const std::string& pngPath, TextureFileFormat format, TexturePlaceholder placeholder = PLACEHOLDER_GREY);
+	// Upload the decoded textures, at least one and then up to maxBytes, and retire the finished copies.
+	// Called once per frame on the GL thread
+	void update(size_t maxBytes);
+	// The texture to bind for `texture`, its placeholder while it is still loading
+	GLuint resolve(GLuint texture) const {
+		if (loading.empty()) return texture;
+		auto found = loading.find(texture);
+		return found == loading.end() ? texture : placeholders[found->second];
+	}
+	// Number of requested textures that are not usable yet
+	size_t pending() const { return loading.size(); }
+
+private:
+	struct Request {
+		GLuint texture;
+		std::string path;
+		TextureFileFormat format;
+	};
+
+	// A mapped texture file, its levels are copied to the staging buffer in file layout unless stagingOffset is INVALID
+	struct Decoded {
+		GLuint texture;
+		MappedFile file;
+		uint32_t stagingOffset;
+		uint32_t size;
+	};
+
+	struct Upload {
+		GLuint texture;
+		GLsync fence;
+		uint32_t stagingOffset;
+		uint32_t size;
+	};
+
+	void workerLoop();
+	void load(const Request& request, Decoded& decoded);
+	void upload(Decoded& decoded);
+
+	// Disable copying and assignment
+	TextureStreamer(TextureStreamer const &) = delete;
+	TextureStreamer & operator =(TextureStreamer const &) = delete;
+
+	GLuint placeholders[MAX_PLACEHOLDERS] = { 0 };
+	// Texture -> placeholder, for the textures that are not usable yet. Only touched on the GL thread
+	std::unordered_map<GLuint, TexturePlaceholder> loading;
+
+	GLuint stagingBuffer = 0;
+	uint8_t* staging = nullptr;
+	std::vector<Upload> uploads;
+
+	// Guards everything below, shared with the workers
+	std::mutex mutex;
+	std::condition_variable wake;
+	// Signalled when staging memory is freed
+	std::condition_variable stagingFreed;
+	RangeAllocator stagingSpace;
+	std::deque<Request> requests;
+	std::deque<Decoded> decoded;
+	std::vector<std::thread> workers;
+	bool stopping = false;
+};
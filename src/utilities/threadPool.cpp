@@ -0,0 +1,110 @@
+#include "threadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+	if (threadCount == 0) threadCount = 1;
+
+	currentTask = nullptr;
+	remaining = 0;
+
+	for (unsigned int i = 0; i < threadCount; i++) {
+		queues.emplace_back(new TaskQueue());
+	}
+	// Queue 0 belongs to the thread calling parallelFor
+	for (unsigned int i = 1; i < threadCount; i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::parallelFor(unsigned int count, const std::function<void(unsigned int)>& task) {
+	if (count == 0) return;
+
+	if (queues.size() == 1) {
+		for (unsigned int i = 0; i < count; i++) {
+			task(i);
+		}
+		return;
+	}
+
+	// The task must be visible before any index is queued, the queue mutexes order the two
+	currentTask = &task;
+	remaining = count;
+
+	// Hand out contiguous blocks so neighbouring tasks, which often touch neighbouring memory, share a thread
+	const unsigned int queueCount = queues.size();
+	for (unsigned int q = 0; q < queueCount; q++) {
+		const unsigned int begin = count * q / queueCount;
+		const unsigned int end = count * (q + 1) / queueCount;
+		std::lock_guard<std::mutex> lock(queues[q]->mutex);
+		for (unsigned int i = begin; i < end; i++) {
+			queues[q]->tasks.push_back(i);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		jobGeneration++;
+	}
+	wake.notify_all();
+
+	while (remaining.load() > 0) {
+		if (!runOne(0)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool ThreadPool::pop(unsigned int queue, unsigned int& task) {
+	TaskQueue& own = *queues[queue];
+	std::lock_guard<std::mutex> lock(own.mutex);
+	if (own.tasks.empty()) return false;
+	task = own.tasks.back();
+	own.tasks.pop_back();
+	return true;
+}
+
+bool ThreadPool::steal(unsigned int thief, unsigned int& task) {
+	const unsigned int queueCount = queues.size();
+	for (unsigned int offset = 1; offset < queueCount; offset++) {
+		TaskQueue& victim = *queues[(thief + offset) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (victim.tasks.empty()) continue;
+		task = victim.tasks.front();
+		victim.tasks.pop_front();
+		return true;
+	}
+	return false;
+}
+
+bool ThreadPool::runOne(unsigned int queue) {
+	unsigned int task;
+	if (!pop(queue, task) && !steal(queue, task)) {
+		return false;
+	}
+	(*currentTask.load())(task);
+	remaining--;
+	return true;
+}
+
+void ThreadPool::workerLoop(unsigned int queue) {
+	unsigned int seenGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			wake.wait(lock, [&]() { return stopping || jobGeneration != seenGeneration; });
+			if (stopping) return;
+			seenGeneration = jobGeneration;
+		}
+		while (runOne(queue)) {}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing thread pool. Each thread owns a queue of task indices, works through its own
+// queue from the back and steals from the front of the other queues once it runs dry.
+// The thread calling parallelFor takes part in the work, so a pool of size N runs on N threads
+// with N - 1 of them being background workers.
+class ThreadPool {
+public:
+	explicit ThreadPool(unsigned int threadCount);
+	~ThreadPool();
+
+	// Total number of threads working on a parallelFor, including the calling thread
+	unsigned int size() const { return queues.size(); }
+
+	// Run task(i) for every i in [0, count) and return once all of them have finished.
+	// Must only be called from one thread at a time.
+	void parallelFor(unsigned int count, const std::function<void(unsigned int)>& task);
+
+private:
+	struct TaskQueue {
+		std::deque<unsigned int> tasks;
+		std::mutex mutex;
+	};
+
+	bool pop(unsigned int queue, unsigned int& task);
+	bool steal(unsigned int thief, unsigned int& task);
+	bool runOne(unsigned int queue);
+	void workerLoop(unsigned int queue);
+
+	// Disable copying and assignment
+	ThreadPool(ThreadPool const &) = delete;
+	ThreadPool & operator =(ThreadPool const &) = delete;
+
+	std::vector<std::unique_ptr<TaskQueue>> queues;
+	std::vector<std::thread> workers;
+
+	std::atomic<const std::function<void(unsigned int)>*> currentTask;
+	std::atomic<unsigned int> remaining;
+
+	// Wakes the workers when a new parallelFor is started
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	unsigned int jobGeneration = 0;
+	bool stopping = false;
+};
@@ -0,0 +1,203 @@
+#include "transformKernel.hpp"
+#include "simd.hpp"
+#include <cmath>
+
+// One aligned scratch buffer per vector register
+struct alignas(32) Lanes {
+	float v[WIDTH];
+};
+
+struct vvec3 {
+	vfloat x, y, z;
+};
+
+inline vvec3 vscale(const vvec3& a, vfloat s) {
+	return { vmul(a.x, s), vmul(a.y, s), vmul(a.z, s) };
+}
+
+inline vfloat vdot(const vvec3& a, const vvec3& b) {
+	return vadd(vadd(vmul(a.x, b.x), vmul(a.y, b.y)), vmul(a.z, b.z));
+}
+
+inline vvec3 vcross(const vvec3& a, const vvec3& b) {
+	return {
+		vsub(vmul(a.y, b.z), vmul(a.z, b.y)),
+		vsub(vmul(a.z, b.x), vmul(a.x, b.z)),
+		vsub(vmul(a.x, b.y), vmul(a.y, b.x))
+	};
+}
+
+// Gather component `c` of `data[indices[i]]` into the lanes, partial batches repeat the first entry
+template <class T> inline vfloat gather(const T* data, const unsigned int* indices, unsigned int count, int c) {
+	Lanes lanes;
+	for (unsigned int lane = 0; lane < WIDTH; lane++) {
+		lanes.v[lane] = data[indices[lane < count ? lane : 0]][c];
+	}
+	return vload(lanes.v);
+}
+
+inline vvec3 gatherVec3(const glm::vec3* data, const unsigned int* indices, unsigned int count) {
+	return { gather(data, indices, count, 0), gather(data, indices, count, 1), gather(data, indices, count, 2) };
+}
+
+inline vvec3 gatherColumn(const glm::mat4* data, const unsigned int* indices, unsigned int count, int column) {
+	Lanes x, y, z;
+	for (unsigned int lane = 0; lane < WIDTH; lane++) {
+		const glm::vec4& v = data[indices[lane < count ? lane : 0]][column];
+		x.v[lane] = v.x;
+		y.v[lane] = v.y;
+		z.v[lane] = v.z;
+	}
+	return { vload(x.v), vload(y.v), vload(z.v) };
+}
+
+struct ColumnLanes {
+	Lanes x, y, z;
+};
+
+inline void storeColumn(ColumnLanes& out, const vvec3& v) {
+	vstore(out.x.v, v.x);
+	vstore(out.y.v, v.y);
+	vstore(out.z.v, v.z);
+}
+
+// sin and cos of every lane.
+// The angle is reduced to r in [-pi/2, pi/2] with x = q * pi + r, then sin(x) = (-1)^q sin(r)
+// and cos(x) = (-1)^q cos(r) are evaluated with Taylor polynomials accurate to float precision.
+inline void vsincos(vfloat x, vfloat& s, vfloat& c) {
+	const float INV_PI = 0.318309886183790671f;
+	// pi split in two so q * PI_A is exact
+	const float PI_A = 3.140625f;
+	const float PI_B = 9.67653589793e-4f;
+
+	vfloat q = vfloor(vadd(vmul(x, vset(INV_PI)), vset(0.5f)));
+	vfloat r = vsub(vsub(x, vmul(q, vset(PI_A))), vmul(q, vset(PI_B)));
+
+	// sign = 1 - 2 * (q mod 2)
+	vfloat parity = vsub(q, vmul(vfloor(vmul(q, vset(0.5f))), vset(2.0f)));
+	vfloat sign = vsub(vset(1.0f), vmul(parity, vset(2.0f)));
+
+	vfloat r2 = vmul(r, r);
+
+	vfloat sp = vset(-1.0f / 39916800.0f);
+	sp = vadd(vmul(sp, r2), vset(1.0f / 362880.0f));
+	sp = vadd(vmul(sp, r2), vset(-1.0f / 5040.0f));
+	sp = vadd(vmul(sp, r2), vset(1.0f / 120.0f));
+	sp = vadd(vmul(sp, r2), vset(-1.0f / 6.0f));
+	sp = vadd(vmul(sp, r2), vset(1.0f));
+	s = vmul(vmul(sp, r), sign);
+
+	vfloat cp = vset(1.0f / 479001600.0f);
+	cp = vadd(vmul(cp, r2), vset(-1.0f / 3628800.0f));
+	cp = vadd(vmul(cp, r2), vset(1.0f / 40320.0f));
+	cp = vadd(vmul(cp, r2), vset(-1.0f / 720.0f));
+	cp = vadd(vmul(cp, r2), vset(1.0f / 24.0f));
+	cp = vadd(vmul(cp, r2), vset(-1.0f / 2.0f));
+	cp = vadd(vmul(cp, r2), vset(1.0f));
+	c = vmul(cp, sign);
+}
+
+const char* transformKernelName() {
+	return SIMD_NAME;
+}
+
+void composeTransforms(const unsigned int* indices, unsigned int count,
+	const glm::vec3* position, const glm::vec3* referencePoint,
+	const glm::vec3* rotation, const glm::vec3* scale, glm::mat4* out) {
+
+	for (unsigned int batch = 0; batch < count; batch += WIDTH) {
+		const unsigned int* batchIndices = indices + batch;
+		const unsigned int batchCount = count - batch;
+
+		vvec3 p = gatherVec3(position, batchIndices, batchCount);
+		vvec3 ref = gatherVec3(referencePoint, batchIndices, batchCount);
+		vvec3 rot = gatherVec3(rotation, batchIndices, batchCount);
+		vvec3 s = gatherVec3(scale, batchIndices, batchCount);
+
+		vfloat sx, cx, sy, cy, sz, cz;
+		vsincos(rot.x, sx, cx);
+		vsincos(rot.y, sy, cy);
+		vsincos(rot.z, sz, cz);
+
+		// Columns of R = Ry * Rx * Rz
+		vfloat sysx = vmul(sy, sx);
+		vfloat cysx = vmul(cy, sx);
+		vvec3 r0 = { vadd(vmul(cy, cz), vmul(sysx, sz)), vmul(cx, sz), vsub(vmul(cysx, sz), vmul(sy, cz)) };
+		vvec3 r1 = { vsub(vmul(sysx, cz), vmul(cy, sz)), vmul(cx, cz), vadd(vmul(sy, sz), vmul(cysx, cz)) };
+		vvec3 r2 = { vmul(sy, cx), vsub(vset(0.0f), sx), vmul(cy, cx) };
+
+		vvec3 m0 = vscale(r0, s.x);
+		vvec3 m1 = vscale(r1, s.y);
+		vvec3 m2 = vscale(r2, s.z);
+
+		// Translation: position + referencePoint - R * S * referencePoint
+		vvec3 t = {
+			vsub(vadd(p.x, ref.x), vadd(vadd(vmul(m0.x, ref.x), vmul(m1.x, ref.y)), vmul(m2.x, ref.z))),
+			vsub(vadd(p.y, ref.y), vadd(vadd(vmul(m0.y, ref.x), vmul(m1.y, ref.y)), vmul(m2.y, ref.z))),
+			vsub(vadd(p.z, ref.z), vadd(vadd(vmul(m0.z, ref.x), vmul(m1.z, ref.y)), vmul(m2.z, ref.z)))
+		};
+
+		ColumnLanes c0, c1, c2, c3;
+		storeColumn(c0, m0);
+		storeColumn(c1, m1);
+		storeColumn(c2, m2);
+		storeColumn(c3, t);
+
+		for (unsigned int lane = 0; lane < WIDTH && lane < batchCount; lane++) {
+			glm::mat4& m = out[batchIndices[lane]];
+			m[0] = glm::vec4(c0.x.v[lane], c0.y.v[lane], c0.z.v[lane], 0.0f);
+			m[1] = glm::vec4(c1.x.v[lane], c1.y.v[lane], c1.z.v[lane], 0.0f);
+			m[2] = glm::vec4(c2.x.v[lane], c2.y.v[lane], c2.z.v[lane], 0.0f);
+			m[3] = glm::vec4(c3.x.v[lane], c3.y.v[lane], c3.z.v[lane], 1.0f);
+		}
+	}
+}
+
+inline void scatterMat3(glm::mat3* out, const unsigned int* indices, unsigned int count, const vvec3& a, const vvec3& b, const vvec3& c) {
+	ColumnLanes c0, c1, c2;
+	storeColumn(c0, a);
+	storeColumn(c1, b);
+	storeColumn(c2, c);
+
+	for (unsigned int lane = 0; lane < WIDTH && lane < count; lane++) {
+		glm::mat3& m = out[indices[lane]];
+		m[0] = glm::vec3(c0.x.v[lane], c0.y.v[lane], c0.z.v[lane]);
+		m[1] = glm::vec3(c1.x.v[lane], c1.y.v[lane], c1.z.v[lane]);
+		m[2] = glm::vec3(c2.x.v[lane], c2.y.v[lane], c2.z.v[lane]);
+	}
+}
+
+void computeNormalMatrices(const unsigned int* indices, unsigned int count, const glm::mat4* world, glm::mat3* out) {
+	for (unsigned int batch = 0; batch < count; batch += WIDTH) {
+		const unsigned int* batchIndices = indices + batch;
+		const unsigned int batchCount = count - batch;
+
+		vvec3 a = gatherColumn(world, batchIndices, batchCount, 0);
+		vvec3 b = gatherColumn(world, batchIndices, batchCount, 1);
+		vvec3 c = gatherColumn(world, batchIndices, batchCount, 2);
+
+		// The rows of the inverse are the cross products of the columns divided by the determinant,
+		// so the columns of the inverse transpose are the same cross products
+		vvec3 bc = vcross(b, c);
+		vvec3 ca = vcross(c, a);
+		vvec3 ab = vcross(a, b);
+		vfloat invDet = vdiv(vset(1.0f), vdot(a, bc));
+
+		scatterMat3(out, batchIndices, batchCount, vscale(bc, invDet), vscale(ca, invDet), vscale(ab, invDet));
+	}
+}
+
+void computeUniformNormalMatrices(const unsigned int* indices, unsigned int count, const glm::mat4* world, glm::mat3* out) {
+	for (unsigned int batch = 0; batch < count; batch += WIDTH) {
+		const unsigned int* batchIndices = indices + batch;
+		const unsigned int batchCount = count - batch;
+
+		vvec3 a = gatherColumn(world, batchIndices, batchCount, 0);
+		vvec3 b = gatherColumn(world, batchIndices, batchCount, 1);
+		vvec3 c = gatherColumn(world, batchIndices, batchCount, 2);
+
+		vfloat invScale2 = vdiv(vset(1.0f), vdot(a, a));
+
+		scatterMat3(out, batchIndices, batchCount, vscale(a, invScale2), vscale(b, invScale2), vscale(c, invScale2));
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Batched transform kernels used by the scene graph update.
+// Compiled for AVX2 or SSE4.1 when the compiler targets them (see ENABLE_AVX2 in CMakeLists.txt),
+// otherwise a scalar fallback with the same math is used.
+// All kernels work on the entries listed in `indices`, so callers can pass only the dirty nodes.
+
+// Name of the instruction set the kernels were compiled for
+const char* transformKernelName();
+
+// Compose local transforms, equivalent to
+// translate(position) * translate(referencePoint) * rotateY * rotateX * rotateZ * scale * translate(-referencePoint)
+void composeTransforms(const unsigned int* indices, unsigned int count,
+	const glm::vec3* position, const glm::vec3* referencePoint,
+	const glm::vec3* rotation, const glm::vec3* scale, glm::mat4* out);
+
+// Inverse transpose of the upper 3x3 of `world`, computed from cofactors
+void computeNormalMatrices(const unsigned int* indices, unsigned int count, const glm::mat4* world, glm::mat3* out);
+
+// Same as computeNormalMatrices, but only valid for transforms with uniform scale.
+// The inverse transpose of s * R is R / s, which is the matrix divided by its squared scale
+void computeUniformNormalMatrices(const unsigned int* indices, unsigned int count, const glm::mat4* world, glm::mat3* out);
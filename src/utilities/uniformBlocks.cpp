@@ -0,0 +1,60 @@
+#include "uniformBlocks.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+const UniformBlockMember* findMember(const UniformBlockLayout& layout, const std::string& name) {
+	for (size_t i = 0; i < layout.memberCount; i++) {
+		if (name == layout.members[i].name) return &layout.members[i];
+	}
+	return nullptr;
+}
+
+bool checkUniformBlock(GLuint program, const UniformBlockLayout& layout) {
+	const GLuint block = glGetProgramResourceIndex(program, GL_UNIFORM_BLOCK, layout.name);
+	if (block == GL_INVALID_INDEX) return true;
+
+	const GLenum blockProperties[] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE, GL_NUM_ACTIVE_VARIABLES };
+	GLint blockValues[3] = {};
+	glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, block, 3, blockProperties, 3, nullptr, blockValues);
+	bool valid = true;
+	if (blockValues[0] != GLint(layout.binding)) {
+		fprintf(stderr, "Uniform block %s is bound to %d, expected %u\n", layout.name, blockValues[0], layout.binding);
+		valid = false;
+	}
+	if (blockValues[1] != GLint(layout.size)) {
+		fprintf(stderr, "Uniform block %s is %d bytes, the struct written to it is %zu\n", layout.name, blockValues[1], layout.size);
+		valid = false;
+	}
+	if (blockValues[2] == 0) return valid;
+
+	std::vector<GLint> variables(blockValues[2]);
+	const GLenum activeVariables = GL_ACTIVE_VARIABLES;
+	glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, block, 1, &activeVariables, GLsizei(variables.size()), nullptr, variables.data());
+
+	GLint maxNameLength = 0;
+	glGetProgramInterfaceiv(program, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+	std::vector<char> name(maxNameLength + 1);
+	for (GLint variable : variables) {
+		glGetProgramResourceName(program, GL_UNIFORM, variable, GLsizei(name.size()), nullptr, name.data());
+		const GLenum properties[] = { GL_OFFSET, GL_ARRAY_STRIDE };
+		GLint values[2] = {};
+		glGetProgramResourceiv(program, GL_UNIFORM, variable, 2, properties, 2, nullptr, values);
+
+		// Members of a block are named Block.member, and arrays by their first element, member[0]
+		std::string member = name.data();
+		member = member.substr(member.find('.') + 1);
+		member = member.substr(0, member.find('['));
+		const UniformBlockMember* expected = findMember(layout, member);
+		if (expected == nullptr) {
+			fprintf(stderr, "Uniform block %s has a member %s that the struct written to it does not have\n", layout.name, member.c_str());
+			valid = false;
+		}
+		else if (values[0] != GLint(expected->offset) || values[1] != GLint(expected->arrayStride)) {
+			fprintf(stderr, "Uniform block %s has %s at offset %d with stride %d, the struct has it at offset %zu with stride %zu\n",
+				layout.name, member.c_str(), values[0], values[1], expected->offset, expected->arrayStride);
+			valid = false;
+		}
+	}
+	return valid;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <cstddef>
+
+// C++ structs written to std140 uniform blocks have to match the offsets the driver gives the members.
+// static_asserts next to the structs check them against the std140 rules, and checkUniformBlock checks
+// them against the linked program, which also catches a shader edited without its struct.
+
+// A member of a block, arrays are named without the brackets and have a stride
+struct UniformBlockMember {
+	const char* name;
+	size_t offset;
+	size_t arrayStride; // 0 if the member is not an array
+};
+
+struct UniformBlockLayout {
+	const char* name;
+	GLuint binding;
+	size_t size;
+	const UniformBlockMember* members;
+	size_t memberCount;
+};
+
+// Compare a uniform block of a linked program with the struct written to it. Prints every difference in
+// binding, size and member offsets and returns false if there are any. A block the program doesn't use is fine
+bool checkUniformBlock(GLuint program, const UniformBlockLayout& layout);
@@ -0,0 +1,106 @@
+#include "vertexFormat.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+const VertexLayout PACKED_VERTEX_LAYOUT = {
+	sizeof(PackedVertex), 4, {
+		{ 0, 3, GL_FLOAT, GL_FALSE, offsetof(PackedVertex, position) },
+		{ 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertex, normal) },
+		{ 2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, textureCoordinates) },
+		{ 3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertex, tangent) },
+	}
+};
+
+void applyVertexLayout(const VertexLayout& layout, GLuint buffer) {
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (unsigned int i = 0; i < layout.attributeCount; i++) {
+		const VertexAttribute& attribute = layout.attributes[i];
+		glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized,
+			layout.stride, (const void*)uintptr_t(attribute.offset));
+		glEnableVertexAttribArray(attribute.location);
+	}
+}
+
+// Round to the nearest step of a signed normalized value with `bits` bits, as two's complement in the low bits
+inline uint32_t packSnorm(float value, int bits) {
+	const float scale = float((1 << (bits - 1)) - 1);
+	const int quantized = int(std::round(std::min(std::max(value, -1.0f), 1.0f) * scale));
+	return uint32_t(quantized) & ((1u << bits) - 1);
+}
+
+inline float unpackSnorm(uint32_t packed, int bits) {
+	// Sign extend from the top bit of the field
+	const int value = int(packed << (32 - bits)) >> (32 - bits);
+	return std::max(float(value) / float((1 << (bits - 1)) - 1), -1.0f);
+}
+
+uint32_t packSnorm1010102(const glm::vec3& value, float w) {
+	return packSnorm(value.x, 10) | (packSnorm(value.y, 10) << 10) | (packSnorm(value.z, 10) << 20) | (packSnorm(w, 2) << 30);
+}
+
+glm::vec4 unpackSnorm1010102(uint32_t packed) {
+	return glm::vec4(
+		unpackSnorm(packed & 0x3FF, 10),
+		unpackSnorm((packed >> 10) & 0x3FF, 10),
+		unpackSnorm((packed >> 20) & 0x3FF, 10),
+		unpackSnorm(packed >> 30, 2));
+}
+
+std::vector<glm::vec4> computeTangentFrames(const Mesh& mesh) {
+	const size_t vertexCount = mesh.vertices.size();
+	std::vector<glm::vec3> tangents(vertexCount, glm::vec3(0));
+	std::vector<glm::vec3> bitTangents(vertexCount, glm::vec3(0));
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		const unsigned int corners[3] = { mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2] };
+		const glm::vec3 deltaPos1 = mesh.vertices[corners[1]] - mesh.vertices[corners[0]];
+		const glm::vec3 deltaPos2 = mesh.vertices[corners[2]] - mesh.vertices[corners[0]];
+		const glm::vec2 deltaUV1 = mesh.textureCoordinates[corners[1]] - mesh.textureCoordinates[corners[0]];
+		const glm::vec2 deltaUV2 = mesh.textureCoordinates[corners[2]] - mesh.textureCoordinates[corners[0]];
+		const float determinant = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+		if (determinant == 0.0f) continue;
+
+		// Not normalized, so larger triangles weigh more in the average
+		const float f = 1.0f / determinant;
+		const glm::vec3 tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * f;
+		const glm::vec3 bitTangent = (deltaPos2 * deltaUV1.x - deltaPos1 * deltaUV2.x) * f;
+		for (unsigned int corner : corners) {
+			tangents[corner] += tangent;
+			bitTangents[corner] += bitTangent;
+		}
+	}
+
+	std::vector<glm::vec4> frames(vertexCount, glm::vec4(0));
+	for (size_t i = 0; i < vertexCount; i++) {
+		const glm::vec3 normal = i < mesh.normals.size() ? mesh.normals[i] : glm::vec3(0);
+		// Gram-Schmidt, the tangent frame has to be orthonormal for the bitangent to be rebuilt from it
+		glm::vec3 tangent = tangents[i] - normal * glm::dot(normal, tangents[i]);
+		const float length = glm::length(tangent);
+		if (length == 0.0f) continue;
+		tangent = tangent / length;
+		const float handedness = glm::dot(glm::cross(normal, tangent), bitTangents[i]) < 0.0f ? -1.0f : 1.0f;
+		frames[i] = glm::vec4(tangent, handedness);
+	}
+	return frames;
+}
+
+std::vector<PackedVertex> packVertices(const Mesh& mesh) {
+	const size_t vertexCount = mesh.vertices.size();
+	const bool hasNormals = mesh.normals.size() == vertexCount;
+	const bool hasTextureCoordinates = mesh.textureCoordinates.size() == vertexCount;
+
+	std::vector<glm::vec4> tangents;
+	if (hasTextureCoordinates) {
+		tangents = computeTangentFrames(mesh);
+	}
+
+	std::vector<PackedVertex> packed(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		PackedVertex& vertex = packed[i];
+		vertex.position = mesh.vertices[i];
+		vertex.normal = hasNormals ? packSnorm1010102(mesh.normals[i], 0.0f) : 0;
+		vertex.tangent = hasTextureCoordinates ? packSnorm1010102(glm::vec3(tangents[i]), tangents[i].w) : 0;
+		vertex.textureCoordinates = hasTextureCoordinates ? glm::packHalf2x16(mesh.textureCoordinates[i]) : 0;
+	}
+	return packed;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "mesh.h"
+
+// One attribute of an interleaved vertex, location is the attribute location in the shader
+struct VertexAttribute {
+	GLuint location;
+	GLint components;
+	GLenum type;
+	GLboolean normalized;
+	GLuint offset;
+};
+
+// Describes how the attributes are laid out in one interleaved vertex buffer
+struct VertexLayout {
+	static const unsigned int MAX_ATTRIBUTES = 8;
+
+	GLsizei stride;
+	unsigned int attributeCount;
+	VertexAttribute attributes[MAX_ATTRIBUTES];
+};
+
+// Point the attributes of the bound VAO at `buffer` and enable them
+void applyVertexLayout(const VertexLayout& layout, GLuint buffer);
+
+// 3D vertex as stored in the geometry heap, 24 bytes instead of the 56 of separate float streams.
+// The bitangent is not stored, the shader rebuilds it as cross(normal, tangent) * tangent.w
+struct PackedVertex {
+	glm::vec3 position;
+	// GL_INT_2_10_10_10_REV, w is unused
+	uint32_t normal;
+	// GL_INT_2_10_10_10_REV, w is the handedness of the tangent frame
+	uint32_t tangent;
+	// Two half floats
+	uint32_t textureCoordinates;
+};
+
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex is uploaded as is");
+
+// Layout of PackedVertex, the locations match geometry.vert
+extern const VertexLayout PACKED_VERTEX_LAYOUT;
+
+// Signed normalized 10 bit x, y and z and 2 bit w, the layout of GL_INT_2_10_10_10_REV
+uint32_t packSnorm1010102(const glm::vec3& value, float w);
+glm::vec4 unpackSnorm1010102(uint32_t packed);
+
+// Per vertex tangent and handedness of an indexed triangle mesh, accumulated over the triangles using each vertex
+// and made orthogonal to the vertex normal. w is -1 when the UV space is mirrored
+std::vector<glm::vec4> computeTangentFrames(const Mesh& mesh);
+
+// Interleave and pack the mesh. Missing normals and texture coordinates are packed as zero,
+// tangents are only computed for meshes with texture coordinates
+std::vector<PackedVertex> packVertices(const Mesh& mesh);
@@ -16,4 +16,13 @@ const int         windowSamples   = 4;
 struct CommandLineOptions {
     bool enableMusic;
     bool enableAutoplay;
+
+    // Adds a generated scene to the game and reports per phase frame timings as JSON
+    bool enableStressTest;
+    unsigned int stressNodes;
+    unsigned int stressDepth;
+    unsigned int stressFanout;
+    float stressDynamicRatio;
+    unsigned int stressFrames;
+    std::string stressReport;
 };
\ No newline at end of file